@@ -0,0 +1,57 @@
+#!/bin/sh
+# Compares scan with grep -E on generated input, read from a mapped file and
+# from a pipe. The input is a few MB of short lines around one long line,
+# so lines straddle scan's 1MB read blocks and one outgrows a block.
+#     ./check_scan.sh ./scan '(GET|POST) /admin'
+
+set -eu
+
+scan=$1
+pattern=$2
+
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+awk 'BEGIN {
+    split("GET /admin|POST /admin/x|PUT /admin|GET /admi|x GET /admin y||POST  /admin|GET /adminGET /admin", lines, "|")
+    for (i = 0; i < 150000; i++) {
+        print lines[i % 8 + 1] substr("................", 1, i % 13)
+        if (i == 70000) {
+            long = "0123456789"
+            for (k = 0; k < 18; k++)
+                long = long long
+            print long "GET /admin"
+        }
+    }
+    printf "GET /admin"
+}' > "$dir/input"
+
+status=0
+check() {
+    name=$1
+    if ! cmp -s "$dir/expected" "$dir/got"; then
+        echo "scan: $name differs from grep"
+        status=1
+    fi
+}
+
+grep -E "$pattern" "$dir/input" > "$dir/expected" || true
+"$scan" "$dir/input" > "$dir/got" 2> /dev/null || true
+check "search"
+"$scan" < "$dir/input" > "$dir/got" 2> /dev/null || true
+check "search on a pipe"
+"$scan" -B "$dir/input" > "$dir/got" 2> /dev/null || true
+check "-B"
+
+grep -Ex "$pattern" "$dir/input" > "$dir/expected" || true
+"$scan" -x "$dir/input" > "$dir/got" 2> /dev/null || true
+check "-x"
+cat "$dir/input" | "$scan" -x > "$dir/got" 2> /dev/null || true
+check "-x on a pipe"
+
+grep -Ec "$pattern" "$dir/input" > "$dir/expected" || true
+"$scan" -c "$dir/input" > "$dir/got" 2> /dev/null || true
+check "-c"
+
+[ $status -eq 0 ] && echo "scan: ok"
+exit $status
@@ -0,0 +1,93 @@
+// Table-driven DFA against the same DFA compiled into code.
+//     make -C bench run-codegen
+// With --check nothing is timed, the two answers are compared on every
+// input. Either way a disagreement makes the exit status non-zero.
+
+#include <chrono>
+#include <cstdio>
+#include <match.h>
+#include <random>
+#include <string>
+#include <vector>
+
+static constexpr fixed_string small_pattern("a(ab|cd)+");
+static constexpr fixed_string large_pattern("(a|b)*a(a|b)(a|b)(a|b)(a|b)(a|b)");
+static constexpr fixed_string loop_pattern("(a|b|c|d|e|f)+@(a|b|c|d|e|f)+");
+
+// inputs that match the pattern about half of the time
+static std::vector<std::string> make_inputs(const char* alphabet, int n_alpha, int count, int length) {
+    std::mt19937             rng(42);
+    std::vector<std::string> res(count);
+    for (std::string& s : res) {
+        s = "a";
+        for (int i = 1; i < length; i++) {
+            s += alphabet[rng() % n_alpha];
+        }
+    }
+    return res;
+}
+
+static bool check_only = false;
+static int  mismatches = 0;
+
+template <auto& pattern, typename Engine>
+void bench(const char* name, const std::vector<std::string>& inputs) {
+    using clock = std::chrono::steady_clock;
+
+    size_t bytes = 0, matched = 0;
+    auto   start = clock::now();
+    for (int rep = 0; rep < 20; rep++) {
+        for (const std::string& s : inputs) {
+            matched += match<pattern, Engine>(s);
+            bytes += s.size();
+        }
+    }
+    double secs = std::chrono::duration<double>(clock::now() - start).count();
+
+    printf("  %-8s %8.1f MB/s  (%zu matched)\n", name, bytes / secs / 1e6, matched);
+}
+
+template <auto& pattern>
+void bench_pattern(const char* title, const std::vector<std::string>& inputs) {
+    printf("%s, %d DFA states\n", title, compiled<pattern>::dfa.state_count());
+
+    for (const std::string& s : inputs) {
+        if (match<pattern, dfa_engine>(s) != match<pattern, codegen_engine>(s)) {
+            printf("  table and codegen disagree on \"%s\"\n", s.c_str());
+            mismatches++;
+        }
+    }
+    if (check_only)
+        return;
+
+    bench<pattern, dfa_engine>("table", inputs);
+    bench<pattern, codegen_engine>("codegen", inputs);
+}
+
+int main(int argc, char** argv) {
+    check_only = argc > 1 && std::string(argv[1]) == "--check";
+
+    // alternating ab/cd pairs, a few of them broken
+    std::vector<std::string> pairs = make_inputs("abcd", 4, 10000, 201);
+    for (std::string& s : pairs) {
+        for (size_t i = 1; i + 1 < s.size(); i += 2) {
+            s[i]     = (s[i] & 1) ? 'a' : 'c';
+            s[i + 1] = s[i] == 'a' ? 'b' : 'd';
+        }
+    }
+    for (size_t i = 0; i < pairs.size(); i += 2) {
+        pairs[i].back() = 'x';
+    }
+
+    bench_pattern<small_pattern>("small: a(ab|cd)+", pairs);
+    bench_pattern<large_pattern>("large: (a|b)*a(a|b){5}", make_inputs("ab", 2, 10000, 200));
+
+    // long runs that stay in one state
+    std::vector<std::string> mails = make_inputs("abcdef", 6, 10000, 200);
+    for (std::string& s : mails) {
+        s[100] = '@';
+    }
+    bench_pattern<loop_pattern>("loops: (a|...|f)+@(a|...|f)+", mails);
+
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,153 @@
+// Compile time and peak compiler memory per pattern family and size. Every
+// pattern is written to a translation unit that instantiates match<> and
+// search<>, which is then compiled by $CXX (g++ if unset).
+//     make -C bench run-compile-time
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+#ifndef CTRE_SRC
+#define CTRE_SRC "../src"
+#endif
+
+// patterns at or above this length use the flat front end, see match.h
+static const size_t flat_parser_threshold = 48;
+
+struct result {
+    bool   ok;
+    double secs;
+    double peak_mb;
+};
+
+static std::string escape(const std::string& pattern) {
+    std::string res;
+    for (char c : pattern) {
+        if (c == '"' || c == '\\')
+            res += '\\';
+        res += c;
+    }
+    return res;
+}
+
+static result compile(const char* compiler, const std::string& pattern) {
+    char path[] = "/tmp/ctre_compile_time_XXXXXX.cc";
+    int  fd     = mkstemps(path, 3);
+    if (fd < 0) {
+        perror("mkstemps");
+        exit(1);
+    }
+
+    std::string source = "#include <match.h>\n"
+                         "#include <search.h>\n"
+                         "static constexpr fixed_string pattern(\"" +
+                         escape(pattern) +
+                         "\");\n"
+                         "bool m(std::string_view s) { return match<pattern>(s); }\n"
+                         "bool s(std::string_view s) { return search<pattern>(s).matched; }\n";
+    if (write(fd, source.data(), source.size()) != static_cast<ssize_t>(source.size())) {
+        perror("write");
+        exit(1);
+    }
+    close(fd);
+
+    auto  start = std::chrono::steady_clock::now();
+    pid_t pid   = fork();
+    if (pid == 0) {
+        // keep the compiler's diagnostics out of the table
+        freopen("/dev/null", "w", stderr);
+        execlp(compiler, compiler, "-std=c++17", "-O2", "-I" CTRE_SRC, "-c", path, "-o", "/dev/null", nullptr);
+        _exit(127);
+    }
+
+    int           status = 0;
+    struct rusage usage  = {};
+    wait4(pid, &status, 0, &usage);
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    unlink(path);
+
+    // ru_maxrss is in kilobytes on Linux
+    return { WIFEXITED(status) && WEXITSTATUS(status) == 0, secs, usage.ru_maxrss / 1024.0 };
+}
+
+static void bench_family(const char* compiler, const char* title, const std::vector<std::string>& patterns) {
+    printf("%s\n", title);
+    for (const std::string& pattern : patterns) {
+        result r = compile(compiler, pattern);
+        printf("  %6zu chars  %-4s %8.2f s %8.1f MB  %s\n", pattern.size(),
+               pattern.size() >= flat_parser_threshold ? "flat" : "type", r.secs, r.peak_mb,
+               r.ok ? "" : "FAILED");
+    }
+}
+
+//
+// Patterns
+//
+
+static std::string literal(size_t n) {
+    std::string res;
+    for (size_t i = 0; i < n; i++) {
+        res += static_cast<char>('a' + i % 26);
+    }
+    return res;
+}
+
+// n distinct words of five letters
+static std::string alternation(size_t n) {
+    std::string res;
+    for (size_t i = 0; i < n; i++) {
+        if (i)
+            res += '|';
+        for (size_t j = 0, k = i; j < 5; j++, k /= 26) {
+            res += static_cast<char>('a' + (k + j) % 26);
+        }
+    }
+    return res;
+}
+
+// ((((a)*b)*c)*d)* nested n deep
+static std::string nested_star(size_t n) {
+    std::string res(n, '(');
+    for (size_t i = 0; i < n; i++) {
+        res += static_cast<char>('a' + i % 26);
+        res += ")*";
+    }
+    return res;
+}
+
+// (a|aa)+ repeated n times, (a*)*b blows up backtracking but not automata
+static std::string pathological(size_t n) {
+    std::string res;
+    for (size_t i = 0; i < n; i++) {
+        res += "(a|aa)+";
+    }
+    return res + "c";
+}
+
+int main(int argc, char** argv) {
+    const char* compiler = argc > 1 ? argv[1] : getenv("CXX") ? getenv("CXX") : "g++";
+
+    std::vector<std::string> literals, alternations, nested, pathologicals;
+    for (size_t n : { 8, 16, 32, 64, 128 }) {
+        literals.push_back(literal(n));
+    }
+    for (size_t n : { 4, 16, 64, 256, 1024 }) {
+        alternations.push_back(alternation(n));
+    }
+    for (size_t n : { 2, 4, 8, 16 }) {
+        nested.push_back(nested_star(n));
+    }
+    for (size_t n : { 1, 2, 4, 8 }) {
+        pathologicals.push_back(pathological(n));
+    }
+
+    bench_family(compiler, "literal", literals);
+    bench_family(compiler, "alternation", alternations);
+    bench_family(compiler, "nested star", nested);
+    bench_family(compiler, "pathological", pathologicals);
+}
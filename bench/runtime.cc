@@ -0,0 +1,155 @@
+// Runtime throughput of match against std::regex over pattern families
+// and input sizes.
+//     make -C bench run-runtime
+// With --check nothing is timed, the answers are compared with std::regex.
+// Either way a wrong answer makes the exit status non-zero.
+
+#include <chrono>
+#include <cstdio>
+#include <match.h>
+#include <regex>
+#include <string>
+#include <vector>
+
+static constexpr fixed_string literal_pattern("x*GET /index.html HTTP/1.1");
+static constexpr fixed_string alternation_pattern("(GET|POST|PUT|DELETE|HEAD|PATCH) /(a|b|c|d|e|f|g|h)+");
+static constexpr fixed_string nested_star_pattern("((a|b)*c(d|e)*)*f");
+static constexpr fixed_string star_star_pattern("(a*)*b");
+static constexpr fixed_string a_or_aa_pattern("(a|aa)+c");
+
+// inputs of one size
+using input_set = std::vector<std::string>;
+
+static const size_t sizes[] = { 12, 24, 256, 4096, 65536 };
+
+static bool check_only = false;
+static int  mismatches = 0;
+
+// Runs f over the inputs until at least 0.2s have passed.
+template <typename F>
+void measure(const char* name, const input_set& inputs, F f) {
+    using clock = std::chrono::steady_clock;
+
+    size_t bytes = 0, calls = 0, matched = 0;
+    auto   start = clock::now();
+    double secs  = 0;
+    while (secs < 0.2) {
+        for (const std::string& s : inputs) {
+            matched += f(s);
+            bytes += s.size();
+            calls++;
+        }
+        secs = std::chrono::duration<double>(clock::now() - start).count();
+    }
+
+    printf("    %-10s %10.1f MB/s %12.0f matches/s  (%zu of %zu matched)\n", name, bytes / secs / 1e6,
+           calls / secs, matched / (calls / inputs.size()), inputs.size());
+}
+
+// std::regex backtracks and recurses once per input byte, so it only runs
+// up to regex_limit bytes. Beyond that it takes minutes on the pathological
+// families or overflows the stack.
+template <auto& pattern>
+void bench_family(const char* title, const char* source, input_set (*make)(size_t), size_t regex_limit = 4096) {
+    printf("%s  %s\n", title, source);
+
+    std::regex re(source);
+    for (size_t size : sizes) {
+        input_set inputs = make(size);
+        printf("  %zu bytes\n", size);
+
+        if (size <= regex_limit) {
+            for (const std::string& s : inputs) {
+                if (match<pattern>(s) != std::regex_match(s, re)) {
+                    printf("    mismatch with std::regex on \"%s\"\n", s.c_str());
+                    mismatches++;
+                }
+            }
+        }
+        if (check_only)
+            continue;
+
+        measure("ctre", inputs, [](const std::string& s) { return match<pattern>(s); });
+        if (size <= regex_limit)
+            measure("std::regex", inputs, [&](const std::string& s) { return std::regex_match(s, re); });
+        else
+            printf("    %-10s skipped\n", "std::regex");
+    }
+}
+
+//
+// Inputs
+//
+
+// The literal is padded to size with x, every other input has a y in the
+// padding. All of them pass the literal prefilter.
+static input_set make_literal(size_t size) {
+    input_set res;
+    for (int i = 0; i < 64; i++) {
+        std::string s = "GET /index.html HTTP/1.1";
+        if (size > s.size())
+            s.insert(0, size - s.size(), 'x');
+        if (i % 2)
+            s[0] = 'y';
+        res.push_back(s);
+    }
+    return res;
+}
+
+static input_set make_alternation(size_t size) {
+    static const char* methods[] = { "GET", "POST", "PUT", "DELETE", "HEAD", "PATCH" };
+
+    input_set res;
+    for (int i = 0; i < 64; i++) {
+        std::string s = std::string(methods[i % 6]) + " /";
+        for (size_t j = 0; s.size() < size; j++) {
+            s += static_cast<char>('a' + (i + j * 7) % 8);
+        }
+        if (i % 2)
+            s.back() = 'z';
+        res.push_back(s);
+    }
+    return res;
+}
+
+static input_set make_nested_star(size_t size) {
+    input_set res;
+    for (int i = 0; i < 64; i++) {
+        std::string s;
+        for (size_t j = 0; s.size() + 1 < size; j++) {
+            s += "abce"[(i + j) % 4];
+        }
+        s += i % 2 ? 'f' : 'g';
+        res.push_back(s);
+    }
+    return res;
+}
+
+// Runs of a that end in END, every other one has a second END just before
+// it, which only the engine can reject. Backtracking tries every way to
+// split the run before giving up.
+template <char END>
+static input_set make_a_run(size_t size) {
+    input_set res;
+    for (int i = 0; i < 16; i++) {
+        std::string s(size, 'a');
+        s.back() = END;
+        if (i % 2)
+            s[size - 2] = END;
+        res.push_back(s);
+    }
+    return res;
+}
+
+int main(int argc, char** argv) {
+    check_only = argc > 1 && std::string(argv[1]) == "--check";
+
+    bench_family<literal_pattern>("literal", "x*GET /index.html HTTP/1.1", make_literal);
+    bench_family<alternation_pattern>("alternation", "(GET|POST|PUT|DELETE|HEAD|PATCH) /(a|b|c|d|e|f|g|h)+", make_alternation);
+    bench_family<nested_star_pattern>("nested star", "((a|b)*c(d|e)*)*f", make_nested_star);
+    // std::regex takes seconds past 16 bytes on (a*)*b and past 28 on (a|aa)+c
+    bench_family<star_star_pattern>("pathological", "(a*)*b", make_a_run<'b'>, 12);
+    bench_family<a_or_aa_pattern>("pathological", "(a|aa)+c", make_a_run<'c'>, 24);
+
+    return mismatches ? 1 : 0;
+}
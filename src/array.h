@@ -26,6 +26,9 @@ struct array {
     }
 
     // returns a new constexpr array in ascending order
+    // Bottom-up merge sort, stable and O(N log N). Runs that are already in
+    // order are copied without comparing element by element, so sorting a
+    // sorted array is linear.
     template <typename CMP>
     constexpr auto sorted(CMP cmp) const {
         array<T, N> res = *this;
@@ -33,16 +36,30 @@ struct array {
         if constexpr (N < 2)
             return res;
         else {
-            for (int i = 1; i < N; i++) {
-                for (int j = i; j > 0; j--) {
-                    if (!cmp(res._data[j - 1], res._data[j])) {
-                        T tmp            = res._data[j - 1];
-                        res._data[j - 1] = res._data[j];
-                        res._data[j]     = tmp;
-                    } else {
-                        break;
+            array<T, N> buf;
+            for (int width = 1; width < N; width *= 2) {
+                for (int lo = 0; lo < N; lo += 2 * width) {
+                    int mid = lo + width < N ? lo + width : N;
+                    int hi  = lo + 2 * width < N ? lo + 2 * width : N;
+                    int i = lo, j = mid, k = lo;
+
+                    if (mid < hi && cmp(res._data[mid], res._data[mid - 1])) {
+                        // take from the right run only if strictly smaller
+                        while (i < mid && j < hi) {
+                            if (cmp(res._data[j], res._data[i]))
+                                buf._data[k++] = res._data[j++];
+                            else
+                                buf._data[k++] = res._data[i++];
+                        }
+                    }
+                    while (i < mid) {
+                        buf._data[k++] = res._data[i++];
+                    }
+                    while (j < hi) {
+                        buf._data[k++] = res._data[j++];
                     }
                 }
+                res = buf;
             }
             return res;
         }
@@ -0,0 +1,167 @@
+#ifndef CTRE_BATCH_H
+#define CTRE_BATCH_H
+
+#include "match.h"
+#include <cstddef>
+#include <string_view>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+//
+// Batch matching
+//
+
+// A single DFA walk is bound by load latency: each table load needs the
+// state from the previous one. Walking several inputs at once gives the
+// CPU independent loads to overlap. Lanes advance in blocks as long as the
+// shortest remaining input, so no lane is checked for the end of its input
+// inside a block. A lane whose input is done writes its result and picks
+// up the next input.
+template <int LANES>
+struct batch_lanes {
+    const unsigned char* ptr[LANES]{};
+    size_t               remaining[LANES]{};
+    int                  state[LANES]{};
+    size_t               which[LANES]{};  // index of the input in the lane
+    int                  active = 0;
+
+    // the shortest remaining input among active lanes
+    size_t block() const {
+        size_t res = remaining[0];
+        for (int l = 1; l < LANES && l < active; l++) {
+            res = remaining[l] < res ? remaining[l] : res;
+        }
+        return res;
+    }
+
+    void advance(size_t n) {
+        for (int l = 0; l < active; l++) {
+            ptr[l] += n;
+            remaining[l] -= n;
+        }
+    }
+
+    // retires finished lanes and refills them from inputs[next...]
+    template <int N_S, int STRIDE, typename Str>
+    void refill(const deterministic_automata<N_S, STRIDE>& dfa, const Str* inputs, size_t count, size_t& next, bool* results) {
+        for (int l = 0; l < active;) {
+            if (remaining[l] != 0) {
+                l++;
+                continue;
+            }
+
+            if (which[l] != size_t(-1))
+                results[which[l]] = dfa.is_final_state(state[l]);
+
+            if (next < count) {
+                std::string_view str = inputs[next];
+                ptr[l]               = reinterpret_cast<const unsigned char*>(str.data());
+                remaining[l]         = str.size();
+                state[l]             = dfa.start_state;
+                which[l]             = next++;
+                // an empty input is done right away, look at this lane again
+            } else {
+                // move the last active lane here, the lane it leaves goes
+                // to the dead state
+                active--;
+                ptr[l]        = ptr[active];
+                remaining[l]  = remaining[active];
+                state[l]      = state[active];
+                which[l]      = which[active];
+                state[active] = dfa.dead_state;
+            }
+        }
+    }
+
+    template <int N_S, int STRIDE, typename Str>
+    void start(const deterministic_automata<N_S, STRIDE>& dfa, const Str* inputs, size_t count, size_t& next, bool* results) {
+        active = LANES;
+        for (int l = 0; l < LANES; l++) {
+            remaining[l] = 0;
+            state[l]     = dfa.dead_state;
+            which[l]     = size_t(-1);
+        }
+        refill(dfa, inputs, count, next, results);
+    }
+};
+
+template <int LANES, int N_S, int STRIDE, typename Str>
+void run_batch(const deterministic_automata<N_S, STRIDE>& dfa, const Str* inputs, size_t count, bool* results) {
+    batch_lanes<LANES> lanes;
+    size_t             next = 0;
+
+    lanes.start(dfa, inputs, count, next, results);
+    while (lanes.active > 0) {
+        size_t n = lanes.block();
+
+        for (size_t i = 0; i < n; i++) {
+            for (int l = 0; l < lanes.active; l++) {
+                lanes.state[l] = dfa.next(lanes.state[l], lanes.ptr[l][i]);
+            }
+        }
+
+        lanes.advance(n);
+        lanes.refill(dfa, inputs, count, next, results);
+    }
+}
+
+#ifdef __AVX2__
+// Same as run_batch with 8 lanes, each step is one gather from the table.
+// The byte classes are looked up while the lanes' bytes are collected.
+template <int N_S, int STRIDE, typename Str>
+void run_batch_avx2(const deterministic_automata<N_S, STRIDE>& dfa, const Str* inputs, size_t count, bool* results) {
+    static_assert(sizeof(dfa.transitions[0]) == 4, "gather expects 32 bit states");
+
+    batch_lanes<8> lanes;
+    size_t         next  = 0;
+    const int*     table = dfa.transitions.begin();
+    const int      shift = dfa.classes.stride_bits();
+
+    lanes.start(dfa, inputs, count, next, results);
+    while (lanes.active > 0) {
+        size_t n = lanes.block();
+
+        alignas(32) int bytes[8] = {};
+        __m256i         state    = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lanes.state));
+
+        for (size_t i = 0; i < n; i++) {
+            for (int l = 0; l < lanes.active; l++) {
+                bytes[l] = dfa.classes.of[lanes.ptr[l][i]];
+            }
+            // inactive lanes read the dead state's row with class 0, which
+            // leads back to the dead state
+            __m256i idx = _mm256_add_epi32(_mm256_sll_epi32(state, _mm_cvtsi32_si128(shift)),
+                                           _mm256_load_si256(reinterpret_cast<const __m256i*>(bytes)));
+            state       = _mm256_i32gather_epi32(table, idx, 4);
+        }
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes.state), state);
+        lanes.advance(n);
+        lanes.refill(dfa, inputs, count, next, results);
+    }
+}
+#endif
+
+// Matches inputs[0, count) and stores the results in results[0, count).
+// Str is anything convertible to std::string_view, e.g. std::string.
+// Patterns without a DFA fall back to one match call per input.
+template <auto& pattern, typename Str>
+void match_batch(const Str* inputs, size_t count, bool* results) {
+    using C = compiled<pattern>;
+
+    if constexpr (C::determinize::fits) {
+#ifdef __AVX2__
+        run_batch_avx2(C::dfa, inputs, count, results);
+#else
+        run_batch<8>(C::dfa, inputs, count, results);
+#endif
+    } else {
+        for (size_t i = 0; i < count; i++) {
+            results[i] = match<pattern>(std::string_view(inputs[i]));
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef CTRE_BITSET_H
+#define CTRE_BITSET_H
+
+#include "array.h"
+#include <cstdint>
+
+// Fixed size bit set that works in constant expressions.
+// Used to represent sets of FA states.
+template <int N>
+struct bitset {
+    static constexpr int n_words = N > 0 ? (N + 63) / 64 : 1;
+
+    array<uint64_t, n_words> words;
+
+    constexpr int size() const {
+        return N;
+    }
+
+    constexpr bool test(int idx) const {
+        return (words[idx / 64] >> (idx % 64)) & 1;
+    }
+
+    constexpr void set(int idx) {
+        words[idx / 64] |= uint64_t(1) << (idx % 64);
+    }
+
+    constexpr void reset(int idx) {
+        words[idx / 64] &= ~(uint64_t(1) << (idx % 64));
+    }
+
+    constexpr void clear() {
+        for (int i = 0; i < n_words; i++) {
+            words[i] = 0;
+        }
+    }
+
+    constexpr bool any() const {
+        for (uint64_t w : words) {
+            if (w)
+                return true;
+        }
+        return false;
+    }
+
+    constexpr bool intersects(const bitset& other) const {
+        for (int i = 0; i < n_words; i++) {
+            if (words[i] & other.words[i])
+                return true;
+        }
+        return false;
+    }
+
+    constexpr bool operator==(const bitset& other) const {
+        for (int i = 0; i < n_words; i++) {
+            if (words[i] != other.words[i])
+                return false;
+        }
+        return true;
+    }
+
+    constexpr bool operator!=(const bitset& other) const {
+        return !(*this == other);
+    }
+
+    // FNV-1a over the words, to tell most unequal sets apart cheaply
+    constexpr uint64_t hash() const {
+        uint64_t res = 0xcbf29ce484222325;
+        for (uint64_t w : words) {
+            res = (res ^ w) * 0x100000001b3;
+        }
+        return res;
+    }
+
+    constexpr bitset& operator|=(const bitset& other) {
+        for (int i = 0; i < n_words; i++) {
+            words[i] |= other.words[i];
+        }
+        return *this;
+    }
+};
+
+#endif
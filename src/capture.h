@@ -0,0 +1,636 @@
+#ifndef CTRE_CAPTURE_H
+#define CTRE_CAPTURE_H
+
+#include "match.h"
+#include <cstddef>
+#include <string_view>
+
+//
+// Capture program
+//
+
+// The capturing AST compiled into a small program for a pike VM. save
+// instructions are the tagged epsilon transitions: they record the input
+// position in a slot, group i opens in slot 2i and closes in slot 2i + 1.
+// split tries x before y, which is what makes * greedy and | prefer its
+// left side when a group could match in more than one way.
+//
+// Like std::regex, an iteration of a loop that matched the empty string
+// ends the loop: each iteration saves where it started in a slot after the
+// groups' ones, and check goes to y rather than on if nothing was read
+// since. (a*)*b on "b" then has group 1 "", not unset, and (a*)*b on "ab"
+// has group 1 "" too, from an empty second iteration.
+struct instruction {
+    enum op_code { op_char, op_split, op_jump, op_save, op_check, op_match };
+
+    op_code       op = op_match;
+    unsigned char lo = 0;  // op_char matches the bytes lo to hi
+    unsigned char hi = 0;
+    int           x  = 0;  // target of jump and split, slot of save and check
+    int           y  = 0;  // second target of split, end of check's loop
+
+    constexpr bool match(char c) const {
+        unsigned char b = static_cast<unsigned char>(c);
+        return b >= lo && b <= hi;
+    }
+};
+
+// A class is the alternation of its ranges, laid out like alter. The empty
+// class is a char instruction that matches nothing.
+constexpr int class_program_size(const byte_set& set) {
+    int ranges = range_count(set);
+    return ranges ? 3 * ranges - 2 : 1;
+}
+
+//
+// Program size over AST types
+//
+
+constexpr int program_size(epsilon) {
+    return 0;
+}
+
+template <char C>
+constexpr int program_size(ch<C>) {
+    return 1;
+}
+
+template <bool NEGATED, typename... Items>
+constexpr int program_size(char_class<NEGATED, Items...>) {
+    return class_program_size(class_set<char_class<NEGATED, Items...>>::res);
+}
+
+template <typename... Ts>
+constexpr int program_size(concat<Ts...>) {
+    return (program_size(Ts{}) + ...);
+}
+
+// a split and a jump for each alternative but the last
+template <typename... Ts>
+constexpr int program_size(alter<Ts...>) {
+    return (program_size(Ts{}) + ...) + 2 * (static_cast<int>(sizeof...(Ts)) - 1);
+}
+
+// a split, a save and a check around T, and the jump back
+template <typename T>
+constexpr int program_size(star<T>) {
+    return program_size(T{}) + 4;
+}
+
+template <int ID, typename T>
+constexpr int program_size(capture<ID, T>) {
+    return program_size(T{}) + 2;
+}
+
+// MIN copies, then a split, a save and a check around each optional copy,
+// or the star of {MIN,}
+constexpr int repeat_program_size(int size, int min, int max) {
+    return max < 0 ? (min + 1) * size + 4 : max * size + 3 * (max - min);
+}
+
+template <int MIN, int MAX, typename T>
+constexpr int program_size(repeat<MIN, MAX, T>) {
+    return repeat_program_size(program_size(T{}), MIN, MAX);
+}
+
+//
+// Code emission over AST types
+//
+
+template <int N>
+struct capture_program {
+    array<instruction, N> code;
+    int                   size       = 0;
+    int                   slot_count = 0;  // the groups', then one per loop
+
+    // the save of the innermost loop whose iteration an instruction is in,
+    // -1 outside loops; a loop's own save is in the loop around it
+    array<int, N> loop;
+    int           current_loop = -1;
+    int           loop_depth   = 0;  // of the deepest nest of loops
+
+    constexpr int emit(instruction inst) {
+        code[size] = inst;
+        loop[size] = current_loop;
+        return size++;
+    }
+
+    // emit_body() emits an iteration of the loop that saves its start in
+    // slot, which ends with a check of slot
+    template <typename EmitBody>
+    constexpr int emit_iteration(int slot, EmitBody emit_body) {
+        int outer    = current_loop;
+        current_loop = emit({ instruction::op_save, 0, 0, slot });
+
+        int depth = 1;
+        for (int l = outer; l >= 0; l = loop[l]) {
+            depth++;
+        }
+        loop_depth = depth > loop_depth ? depth : loop_depth;
+
+        emit_body();
+        int check    = emit({ instruction::op_check, 0, 0, slot });
+        current_loop = outer;
+        return check;
+    }
+};
+
+// L1: split L2, end
+// L2: save k
+//     T
+//     check k, end
+//     jump L1
+// end:
+template <int N, typename EmitBody>
+constexpr void emit_star(capture_program<N>& prog, EmitBody emit_body) {
+    int split = prog.emit({ instruction::op_split });
+    prog.code[split].x = prog.size;
+
+    int check = prog.emit_iteration(prog.slot_count++, emit_body);
+    prog.emit({ instruction::op_jump, 0, 0, split });
+    prog.code[split].y = prog.size;
+    prog.code[check].y = prog.size;
+}
+
+// the jumps to the end of an alternation are chained through their x until
+// the end is known
+template <int N>
+constexpr void resolve_jumps(capture_program<N>& prog, int jumps) {
+    while (jumps >= 0) {
+        int prev           = prog.code[jumps].x;
+        prog.code[jumps].x = prog.size;
+        jumps              = prev;
+    }
+}
+
+template <int N>
+constexpr void emit_class(capture_program<N>& prog, const byte_set& set) {
+    int ranges = range_count(set);
+    if (ranges == 0) {
+        prog.emit({ instruction::op_char, 1, 0 });
+        return;
+    }
+
+    int jumps = -1;
+    for_each_range(set, [&](unsigned char lo, unsigned char hi) {
+        if (--ranges == 0) {
+            prog.emit({ instruction::op_char, lo, hi });
+            return;
+        }
+
+        int split = prog.emit({ instruction::op_split });
+        prog.code[split].x = prog.size;
+        prog.emit({ instruction::op_char, lo, hi });
+
+        jumps              = prog.emit({ instruction::op_jump, 0, 0, jumps });
+        prog.code[split].y = prog.size;
+    });
+    resolve_jumps(prog, jumps);
+}
+
+template <int N>
+constexpr void emit(capture_program<N>&, epsilon) {}
+
+template <int N, char C>
+constexpr void emit(capture_program<N>& prog, ch<C>) {
+    constexpr unsigned char b = static_cast<unsigned char>(C);
+    prog.emit({ instruction::op_char, b, b });
+}
+
+template <int N, bool NEGATED, typename... Items>
+constexpr void emit(capture_program<N>& prog, char_class<NEGATED, Items...>) {
+    emit_class(prog, class_set<char_class<NEGATED, Items...>>::res);
+}
+
+template <int N, typename... Ts>
+constexpr void emit(capture_program<N>& prog, concat<Ts...>) {
+    (emit(prog, Ts{}), ...);
+}
+
+template <int N, typename T>
+constexpr void emit(capture_program<N>& prog, alter<T>) {
+    emit(prog, T{});
+}
+
+//     split L1, L2
+// L1: T
+//     jump end
+// L2: the other alternatives
+// end:
+template <int N, typename T1, typename T2, typename... Ts>
+constexpr void emit(capture_program<N>& prog, alter<T1, T2, Ts...>) {
+    int split = prog.emit({ instruction::op_split });
+    prog.code[split].x = prog.size;
+    emit(prog, T1{});
+
+    int jump           = prog.emit({ instruction::op_jump });
+    prog.code[split].y = prog.size;
+    emit(prog, alter<T2, Ts...>{});
+
+    prog.code[jump].x = prog.size;
+}
+
+template <int N, typename T>
+constexpr void emit(capture_program<N>& prog, star<T>) {
+    emit_star(prog, [&] { emit(prog, T{}); });
+}
+
+// x{min,max} with emit_copy() emitting x. The optional copies are nested,
+// x(x(x)?)?, their splits and checks all skip to the end:
+//
+//     x ... x           min times
+//     split L1, end
+// L1: save k
+//     x
+//     check k, end
+//     split L2, end
+// L2: save k
+//     x ...
+// end:
+template <int N, typename EmitCopy>
+constexpr void emit_repeat(capture_program<N>& prog, int min, int max, EmitCopy emit_copy) {
+    for (int i = 0; i < min; i++) {
+        emit_copy();
+    }
+
+    if (max < 0) {
+        emit_star(prog, emit_copy);
+        return;
+    }
+
+    // the splits and checks are chained through their y until the end is
+    // known
+    int slot  = prog.slot_count++;
+    int exits = -1;
+    for (int i = min; i < max; i++) {
+        int split = prog.emit({ instruction::op_split, 0, 0, 0, exits });
+        prog.code[split].x = prog.size;
+
+        exits              = prog.emit_iteration(slot, emit_copy);
+        prog.code[exits].y = split;
+    }
+    while (exits >= 0) {
+        int prev           = prog.code[exits].y;
+        prog.code[exits].y = prog.size;
+        exits              = prev;
+    }
+}
+
+template <int N, int MIN, int MAX, typename T>
+constexpr void emit(capture_program<N>& prog, repeat<MIN, MAX, T>) {
+    emit_repeat(prog, MIN, MAX, [&] { emit(prog, T{}); });
+}
+
+template <int N, int ID, typename T>
+constexpr void emit(capture_program<N>& prog, capture<ID, T>) {
+    prog.emit({ instruction::op_save, 0, 0, 2 * ID });
+    emit(prog, T{});
+    prog.emit({ instruction::op_save, 0, 0, 2 * ID + 1 });
+}
+
+template <typename AST>
+struct build_capture_program {
+    static constexpr int size        = program_size(AST{}) + 1;
+    static constexpr int group_count = max_group(AST{}) + 1;
+
+    static constexpr auto build() {
+        capture_program<size> res;
+        res.slot_count = 2 * group_count;
+        emit(res, AST{});
+        res.emit({ instruction::op_match });
+        return res;
+    }
+
+    static constexpr auto res = build();
+};
+
+//
+// Program size and code emission over a flat AST
+//
+
+template <int N>
+constexpr int program_size(const flat_AST<N>& ast, int node) {
+    const flat_node& n = ast[node];
+
+    switch (n.kind) {
+    case flat_node::n_char:
+        return 1;
+    case flat_node::n_class:
+        return class_program_size(n.set);
+    case flat_node::n_concat:
+    case flat_node::n_alter: {
+        int res = 0, count = 0;
+        for (int child = n.first; child >= 0; child = ast[child].next) {
+            res += program_size(ast, child);
+            count++;
+        }
+        return n.kind == flat_node::n_alter ? res + 2 * (count - 1) : res;
+    }
+    case flat_node::n_star:
+        return program_size(ast, n.first) + 4;
+    case flat_node::n_opt:
+    case flat_node::n_capture:
+        return program_size(ast, n.first) + 2;
+    case flat_node::n_plus:
+        // concat<T, star<T>>
+        return 2 * program_size(ast, n.first) + 4;
+    case flat_node::n_repeat:
+        return repeat_program_size(program_size(ast, n.first), n.min, n.max);
+    default:
+        return 0;
+    }
+}
+
+template <int N, int M>
+constexpr void emit(capture_program<N>& prog, const flat_AST<M>& ast, int node) {
+    const flat_node& n = ast[node];
+
+    switch (n.kind) {
+    case flat_node::n_char:
+        prog.emit({ instruction::op_char, static_cast<unsigned char>(n.c), static_cast<unsigned char>(n.c) });
+        break;
+    case flat_node::n_class:
+        emit_class(prog, n.set);
+        break;
+    case flat_node::n_concat:
+        for (int child = n.first; child >= 0; child = ast[child].next) {
+            emit(prog, ast, child);
+        }
+        break;
+    case flat_node::n_alter: {
+        // Same code as the nested alter<T1, alter<T2, ...>>. The jumps to
+        // the end are chained through their x until the end is known.
+        int jumps = -1;
+        for (int child = n.first; child >= 0; child = ast[child].next) {
+            if (ast[child].next < 0) {
+                emit(prog, ast, child);
+                break;
+            }
+
+            int split = prog.emit({ instruction::op_split });
+            prog.code[split].x = prog.size;
+            emit(prog, ast, child);
+
+            jumps              = prog.emit({ instruction::op_jump, 0, 0, jumps });
+            prog.code[split].y = prog.size;
+        }
+        resolve_jumps(prog, jumps);
+        break;
+    }
+    case flat_node::n_star:
+        emit_star(prog, [&] { emit(prog, ast, n.first); });
+        break;
+    case flat_node::n_plus:
+        // concat<T, star<T>>
+        emit(prog, ast, n.first);
+        emit_star(prog, [&] { emit(prog, ast, n.first); });
+        break;
+    case flat_node::n_opt: {
+        // alter<T, epsilon>
+        int split = prog.emit({ instruction::op_split });
+        prog.code[split].x = prog.size;
+        emit(prog, ast, n.first);
+
+        int jump           = prog.emit({ instruction::op_jump });
+        prog.code[split].y = prog.size;
+        prog.code[jump].x  = prog.size;
+        break;
+    }
+    case flat_node::n_repeat:
+        emit_repeat(prog, n.min, n.max, [&] { emit(prog, ast, n.first); });
+        break;
+    case flat_node::n_capture:
+        prog.emit({ instruction::op_save, 0, 0, 2 * n.group });
+        emit(prog, ast, n.first);
+        prog.emit({ instruction::op_save, 0, 0, 2 * n.group + 1 });
+        break;
+    default:
+        break;
+    }
+}
+
+// build_capture_program over a flat AST
+template <auto& AST>
+struct flat_capture_program {
+    static constexpr int size        = program_size(AST, 0) + 1;
+    static constexpr int group_count = AST.group_count;
+
+    static constexpr auto build() {
+        capture_program<size> res;
+        res.slot_count = 2 * group_count;
+        emit(res, AST, 0);
+        res.emit({ instruction::op_match });
+        return res;
+    }
+
+    static constexpr auto res = build();
+};
+
+//
+// Engine
+//
+
+// Threads of the pike VM in priority order, each with its own slots.
+// Sized by the program, a thread's two lists of a program are reused by
+// every match, like the lazy DFA's cache.
+//
+// Two visits of a pc within one step only have the same future when the
+// same loops around it are still in an iteration that read nothing, the
+// innermost `empty` ones of them as an inner iteration starts after an
+// outer one. Visits are told apart by pc and empty, DEPTH is the deepest
+// nest of loops.
+template <int N_PC, int N_SLOTS, int DEPTH>
+struct capture_thread_list {
+    using slots = array<size_t, N_SLOTS>;
+
+    // a pc to visit, or with pc -1 a slot to restore once the threads
+    // after a save have been added
+    struct work {
+        int    pc   = 0;
+        int    slot = 0;
+        size_t old  = 0;
+    };
+
+    bitset<N_PC*(DEPTH + 1)>                active;  // every pc and empty visited by add, not only pcs
+    array<int, N_PC>                        pcs;
+    array<slots, N_PC>                      saved;  // indexed by pc
+    int                                     size = 0;
+    array<work, 2 * N_PC * (DEPTH + 1) + 1> stack;  // add's worklist
+
+    void clear() {
+        active.clear();
+        size = 0;
+    }
+
+    // Follows jumps, splits, saves and checks from pc, threads stop at char
+    // and match. Depth first in priority order, on a worklist rather than
+    // the call stack: each visit pushes at most two entries.
+    template <int N>
+    void add(const capture_program<N>& prog, int pc, slots& s, size_t pos) {
+        int top = 0;
+
+        stack[top++] = { pc };
+        while (top > 0) {
+            work w = stack[--top];
+            if (w.pc < 0) {
+                s[w.slot] = w.old;
+                continue;
+            }
+            const instruction& inst = prog.code[w.pc];
+
+            // threads at char and match have read nothing yet in any case
+            int empty = 0;
+            if (inst.op != instruction::op_char && inst.op != instruction::op_match) {
+                for (int l = prog.loop[w.pc]; l >= 0 && s[prog.code[l].x] == pos; l = prog.loop[l]) {
+                    empty++;
+                }
+            }
+            if (active.test(w.pc * (DEPTH + 1) + empty))
+                continue;
+            active.set(w.pc * (DEPTH + 1) + empty);
+
+            switch (inst.op) {
+            case instruction::op_jump:
+                stack[top++] = { inst.x };
+                break;
+            case instruction::op_split:
+                stack[top++] = { inst.y };
+                stack[top++] = { inst.x };
+                break;
+            case instruction::op_save:
+                stack[top++] = { -1, inst.x, s[inst.x] };
+                stack[top++] = { w.pc + 1 };
+                s[inst.x]    = pos;
+                break;
+            case instruction::op_check:
+                stack[top++] = { s[inst.x] == pos ? inst.y : w.pc + 1 };
+                break;
+            default:
+                pcs[size++] = w.pc;
+                saved[w.pc] = s;
+            }
+        }
+    }
+};
+
+// Runs the program anchored on both ends of target_str. On a match, slots
+// holds the group positions of the highest priority thread, npos for
+// groups that took no part in the match. O(n * m) time, no allocation.
+template <int DEPTH, int N_SLOTS, int N>
+bool run_captures(const capture_program<N>& prog, std::string_view target_str, array<size_t, N_SLOTS>& slots) {
+    static thread_local capture_thread_list<N, N_SLOTS, DEPTH> lists[2];
+    int                                                        cur = 0;
+
+    lists[cur].clear();
+
+    for (int i = 0; i < N_SLOTS; i++) {
+        slots[i] = std::string_view::npos;
+    }
+    lists[cur].add(prog, 0, slots, 0);
+
+    for (size_t idx = 0; idx < target_str.size(); idx++) {
+        auto& from = lists[cur];
+        auto& to   = lists[cur ^ 1];
+
+        to.clear();
+        for (int i = 0; i < from.size; i++) {
+            const instruction& inst = prog.code[from.pcs[i]];
+            if (inst.op == instruction::op_char && inst.match(target_str[idx]))
+                to.add(prog, from.pcs[i] + 1, from.saved[from.pcs[i]], idx + 1);
+        }
+
+        if (to.size == 0)
+            return false;
+        cur ^= 1;
+    }
+
+    for (int i = 0; i < lists[cur].size; i++) {
+        int pc = lists[cur].pcs[i];
+        if (prog.code[pc].op == instruction::op_match) {
+            slots = lists[cur].saved[pc];
+            return true;
+        }
+    }
+    return false;
+}
+
+//
+// Results
+//
+
+// Group 0 is the whole match, groups 1...N are the parenthesized ones in
+// the order their ( appears. Groups that took no part in the match, and
+// all groups of a failed match, are empty views with a null data().
+// A group that repeats holds its last iteration, which is empty if it
+// ended the loop by matching the empty string.
+template <int N>
+struct match_groups {
+    bool                           matched = false;
+    array<std::string_view, N + 1> groups;
+
+    static constexpr int size() {
+        return N + 1;
+    }
+
+    explicit operator bool() const {
+        return matched;
+    }
+
+    std::string_view operator[](int idx) const {
+        return groups[idx];
+    }
+
+    template <int IDX>
+    std::string_view get() const {
+        static_assert(IDX >= 0 && IDX <= N, "No such group");
+        return groups[IDX];
+    }
+};
+
+// the capture program of the pattern, from the same front end as compiled<>
+template <auto& pattern, bool FLAT = compiled<pattern>::flat>
+struct capture_program_of {
+    using type = build_capture_program<typename parser<pattern, parse_table>::AST>;
+};
+
+template <auto& pattern>
+struct capture_program_of<pattern, true> {
+    using type = flat_capture_program<flat_parser<pattern>::res>;
+};
+
+// Matches the whole of target_str and extracts the groups. The views point
+// into target_str. Inputs the literal prefilter rejects never reach the VM.
+template <auto& pattern>
+auto match_result(std::string_view target_str) {
+    using C    = compiled<pattern>;
+    using prog = typename capture_program_of<pattern>::type;
+
+    constexpr int N = prog::group_count;
+
+    match_groups<N> res;
+    if (!prefilter_match(C::literals::res, target_str.data(), target_str.size()))
+        return res;
+
+    // slots can't be empty, patterns without groups or loops get an unused
+    // pair
+    constexpr int N_SLOTS = prog::res.slot_count;
+
+    array<size_t, N_SLOTS ? N_SLOTS : 2> slots;
+    if (!run_captures<prog::res.loop_depth>(prog::res, target_str, slots))
+        return res;
+
+    res.matched   = true;
+    res.groups[0] = target_str;
+    for (int i = 0; i < N; i++) {
+        if (slots[2 * i] != std::string_view::npos && slots[2 * i + 1] != std::string_view::npos)
+            res.groups[i + 1] = target_str.substr(slots[2 * i], slots[2 * i + 1] - slots[2 * i]);
+    }
+    return res;
+}
+
+template <auto& pattern>
+auto match_result(const char* data, size_t size) {
+    return match_result<pattern>(std::string_view(data, size));
+}
+
+#endif
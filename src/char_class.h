@@ -0,0 +1,131 @@
+#ifndef CTRE_CHAR_CLASS_H
+#define CTRE_CHAR_CLASS_H
+
+#include "bitset.h"
+
+// Character classes as sets of bytes. Both front ends turn [...], . and
+// the escapes into a byte_set, the automata only see its maximal ranges.
+// Bytes compare unsigned, patterns are matched byte by byte.
+
+using byte_set = bitset<256>;
+
+constexpr void add_range(byte_set& set, unsigned char lo, unsigned char hi) {
+    for (int c = lo; c <= hi; c++) {
+        set.set(c);
+    }
+}
+
+constexpr byte_set complement(const byte_set& set) {
+    byte_set res;
+    for (int i = 0; i < byte_set::n_words; i++) {
+        res.words[i] = ~set.words[i];
+    }
+    return res;
+}
+
+// calls f(lo, hi) for every maximal range of bytes in set, in byte order
+template <typename F>
+constexpr void for_each_range(const byte_set& set, F f) {
+    for (int c = 0; c < 256;) {
+        if (!set.test(c)) {
+            c++;
+            continue;
+        }
+        int lo = c;
+        while (c < 256 && set.test(c)) {
+            c++;
+        }
+        f(static_cast<unsigned char>(lo), static_cast<unsigned char>(c - 1));
+    }
+}
+
+constexpr int range_count(const byte_set& set) {
+    int res = 0;
+    for_each_range(set, [&](unsigned char, unsigned char) { res++; });
+    return res;
+}
+
+// the byte of a single byte set, -1 if it has none or several
+constexpr int single_byte(const byte_set& set) {
+    int res = -1;
+    for (int c = 0; c < 256; c++) {
+        if (set.test(c)) {
+            if (res >= 0)
+                return -1;
+            res = c;
+        }
+    }
+    return res;
+}
+
+// . is every byte but '\n'
+constexpr byte_set any_byte() {
+    byte_set res;
+    res.set('\n');
+    return complement(res);
+}
+
+//
+// Escapes
+//
+
+// The byte \c stands for, -1 for the class escapes \d \w \s and their
+// negations, -2 if \c is not an escape. Punctuation escapes itself, other
+// letters and digits are reserved.
+constexpr int escape_byte(char c) {
+    switch (c) {
+    case 'n':
+        return '\n';
+    case 't':
+        return '\t';
+    case 'r':
+        return '\r';
+    case 'f':
+        return '\f';
+    case 'v':
+        return '\v';
+    case '0':
+        return '\0';
+    case 'd':
+    case 'D':
+    case 'w':
+    case 'W':
+    case 's':
+    case 'S':
+        return -1;
+    default:
+        break;
+    }
+
+    bool alnum = (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+    return alnum ? -2 : static_cast<unsigned char>(c);
+}
+
+// the bytes \c matches, c is a class escape or a byte escape
+constexpr byte_set escape_set(char c) {
+    byte_set res;
+    switch (c) {
+    case 'd':
+    case 'D':
+        add_range(res, '0', '9');
+        break;
+    case 'w':
+    case 'W':
+        add_range(res, '0', '9');
+        add_range(res, 'A', 'Z');
+        add_range(res, 'a', 'z');
+        res.set('_');
+        break;
+    case 's':
+    case 'S':
+        add_range(res, '\t', '\r');
+        res.set(' ');
+        break;
+    default:
+        res.set(static_cast<unsigned char>(escape_byte(c)));
+        return res;
+    }
+    return c >= 'A' && c <= 'Z' ? complement(res) : res;
+}
+
+#endif
@@ -0,0 +1,144 @@
+#ifndef CTRE_CODEGEN_H
+#define CTRE_CODEGEN_H
+
+#include "finite_automata.h"
+#include "instrument.h"
+#include <iterator>
+#include <utility>
+
+//
+// Code generation
+//
+
+// The minimized DFA turned into code instead of a table walk. Every state
+// becomes its own function template whose byte comparisons are compile-time
+// constants, so the compiler is free to lower them to range checks, bit
+// tests or jump tables. Bytes that keep the DFA in the same state are
+// consumed in a tight loop inside the state's function.
+
+// bytes [lo, hi] go to dst
+struct byte_range {
+    unsigned char lo  = 0;
+    unsigned char hi  = 0;
+    int           dst = 0;
+};
+
+// The transitions of every state as maximal runs of bytes with the same
+// target, the runs of state s are res[offset[s], offset[s + 1]).
+// Transitions to the dead state are left out.
+template <auto& DFA>
+struct DFA_ranges {
+    static constexpr int N = DFA.state_count();
+
+    template <typename Output>
+    static constexpr int f(Output& out) {
+        int count = 0;
+        for (int s = 0; s < N; s++) {
+            out.begin_state(s, count);
+            for (int c = 0; c < 256;) {
+                int dst = DFA.next(s, c);
+                int lo  = c;
+                while (c < 256 && DFA.next(s, c) == dst)
+                    c++;
+                if (dst != DFA.dead_state)
+                    out.add(count++, { static_cast<unsigned char>(lo), static_cast<unsigned char>(c - 1), dst });
+            }
+        }
+        out.begin_state(N, count);
+        return count;
+    }
+
+    struct null_output {
+        constexpr void begin_state(int, int) {}
+        constexpr void add(int, byte_range) {}
+    };
+
+    static constexpr int count_ranges() {
+        null_output out;
+        return f(out);
+    }
+
+    static constexpr int count = count_ranges();
+
+    template <int N_R>
+    struct tables {
+        array<int, N + 1>      offset;
+        array<byte_range, N_R> ranges;
+
+        constexpr void begin_state(int s, int idx) {
+            offset[s] = idx;
+        }
+
+        constexpr void add(int idx, byte_range r) {
+            ranges[idx] = r;
+        }
+    };
+
+    static constexpr auto build() {
+        // array can't be empty
+        tables<count ? count : 1> res;
+        f(res);
+        return res;
+    }
+
+    static constexpr auto res = build();
+};
+
+// the state S goes to on byte c
+template <auto& DFA, int S, size_t... I>
+constexpr int codegen_next([[maybe_unused]] unsigned char c, std::index_sequence<I...>) {
+    constexpr auto& t     = DFA_ranges<DFA>::res;
+    constexpr int   first = t.offset[S];
+
+    int res = DFA.dead_state;
+    (void)((c >= t.ranges[first + I].lo && c <= t.ranges[first + I].hi && (res = t.ranges[first + I].dst, true)) || ...);
+    return res;
+}
+
+// Consumes input while it stays in state S. Returns the state after the
+// first byte that leaves S, or S at the end of the input.
+template <auto& DFA, int S, typename It>
+int codegen_state(It& first, It last) {
+    constexpr auto& t = DFA_ranges<DFA>::res;
+    using seq         = std::make_index_sequence<t.offset[S + 1] - t.offset[S]>;
+
+    for (; first != last; ++first) {
+        int next = codegen_next<DFA, S>(static_cast<unsigned char>(*first), seq{});
+        if (next != S) {
+            ++first;
+            return next;
+        }
+    }
+    return S;
+}
+
+// binary search for the function of state in [LO, HI)
+template <auto& DFA, int LO, int HI, typename It>
+int codegen_dispatch(int state, It& first, It last) {
+    if constexpr (HI - LO == 1) {
+        return codegen_state<DFA, LO>(first, last);
+    } else {
+        constexpr int MID = (LO + HI) / 2;
+        if (state < MID)
+            return codegen_dispatch<DFA, LO, MID>(state, first, last);
+        return codegen_dispatch<DFA, MID, HI>(state, first, last);
+    }
+}
+
+// A visited state is one call of a state's function, which may consume
+// many bytes.
+template <auto& DFA, typename It, typename Instrument = no_instrumentation>
+bool run_codegen(It first, It last, Instrument = {}) {
+    int state = DFA.start_state;
+    while (first != last && !DFA.is_decided(state)) {
+        It from = first;
+        state   = codegen_dispatch<DFA, 1, DFA.state_count()>(state, first, last);
+        if constexpr (Instrument::enabled) {
+            Instrument::bytes(std::distance(from, first));
+            Instrument::states(1);
+        }
+    }
+    return DFA.is_final_state(state);
+}
+
+#endif
@@ -0,0 +1,174 @@
+#ifndef CTRE_COMPACT_H
+#define CTRE_COMPACT_H
+
+#include "array.h"
+#include "bitset.h"
+#include "char_class.h"
+#include "finite_automata.h"
+#include <cstdint>
+#include <type_traits>
+
+//
+// Compact layout
+//
+
+// The epsilon-free NFA as the NFA engines read it. finite_automata keeps
+// 12-byte transitions sorted by (src, dst) and binary-searches them for
+// every state and every final state test. Here each state's edges are the
+// range [offset[s], offset[s + 1]) of `edges`, an edge is the byte range
+// and the destination in the narrowest type that holds all state ids, and
+// final states are a bitmask. Small patterns take 3 bytes per edge and fit
+// their whole NFA in a cache line or two.
+//
+// Edges into states that can't reach a final state are left out, so a set
+// of active states that can't match any more is empty. States that are
+// final and stay among such states on every byte accept whatever follows,
+// a thread that reaches one decides the match.
+
+// the narrowest unsigned type that holds 0 .. N
+template <long N>
+using uint_for = std::conditional_t<N <= UINT8_MAX,
+                                    uint8_t,
+                                    std::conditional_t<N <= UINT16_MAX, uint16_t, uint32_t>>;
+
+template <int N_S, int N_T>
+struct compact_automata {
+    static constexpr bool epsilon_free = true;
+
+    using state_id = uint_for<N_S - 1>;
+    using edge_id  = uint_for<N_T>;
+
+    struct edge {
+        unsigned char lo  = 0;
+        unsigned char hi  = 0;
+        state_id      dst = 0;
+
+        constexpr bool match(unsigned char c) const {
+            return c >= lo && c <= hi;
+        }
+    };
+
+    // arrays can't be empty
+    array<edge_id, N_S + 1>    offset;
+    array<edge, N_T ? N_T : 1> edges;
+    bitset<N_S>                final_states;
+    bitset<N_S>                accepting_states;
+
+    constexpr int state_count() const {
+        return N_S;
+    }
+
+    constexpr int size_transition() const {
+        return N_T;
+    }
+
+    constexpr int begin(int state) const {
+        return offset[state];
+    }
+
+    constexpr int end(int state) const {
+        return offset[state + 1];
+    }
+
+    constexpr bool is_final_state(int state) const {
+        return final_states.test(state);
+    }
+
+    constexpr bool is_accepting_state(int state) const {
+        return accepting_states.test(state);
+    }
+};
+
+// NFA must be epsilon-free and sorted, FA_remove_epsilon's result is
+template <auto& NFA>
+struct FA_compact {
+    static_assert(NFA.epsilon_free, "Only epsilon-free FAs have a compact layout");
+
+    // at least the starting state
+    static constexpr int N_S = NFA.state_count() > 0 ? NFA.state_count() : 1;
+
+    // states that reach a final state. Transitions mostly go to higher
+    // states, so walking them backwards settles in a pass or two.
+    static constexpr bitset<N_S> find_live_states() {
+        bitset<N_S> res;
+        for (int s : NFA.final_states) {
+            res.set(s);
+        }
+        for (bool changed = true; changed;) {
+            changed = false;
+            for (int i = NFA.size_transition() - 1; i >= 0; i--) {
+                const transition& t = NFA.transitions[i];
+                if (res.test(t.dst) && !res.test(t.src)) {
+                    res.set(t.src);
+                    changed = true;
+                }
+            }
+        }
+        return res;
+    }
+
+    static constexpr bitset<N_S> live = find_live_states();
+
+    static constexpr int count_live_edges() {
+        int res = 0;
+        for (const transition& t : NFA.transitions) {
+            res += live.test(t.dst);
+        }
+        return res;
+    }
+
+    static constexpr int N_T = count_live_edges();
+
+    // Final states whose edges to accepting states cover every byte, the
+    // largest such set: start from all final states and drop the ones that
+    // don't until none is dropped.
+    template <typename Compact>
+    static constexpr bitset<N_S> find_accepting_states(const Compact& nfa) {
+        bitset<N_S> res = nfa.final_states;
+        for (bool changed = true; changed;) {
+            changed = false;
+            for (int s = 0; s < N_S; s++) {
+                if (!res.test(s))
+                    continue;
+
+                byte_set covered;
+                for (int e = nfa.begin(s); e < nfa.end(s); e++) {
+                    if (res.test(nfa.edges[e].dst))
+                        add_range(covered, nfa.edges[e].lo, nfa.edges[e].hi);
+                }
+                if (complement(covered).any()) {
+                    res.reset(s);
+                    changed = true;
+                }
+            }
+        }
+        return res;
+    }
+
+    static constexpr auto build() {
+        compact_automata<N_S, N_T> res;
+
+        int i = 0;
+        for (const transition& t : NFA.transitions) {
+            if (!live.test(t.dst))
+                continue;
+            res.offset[t.src + 1]++;
+            res.edges[i].lo  = t.lo;
+            res.edges[i].hi  = t.hi;
+            res.edges[i].dst = static_cast<typename compact_automata<N_S, N_T>::state_id>(t.dst);
+            i++;
+        }
+        for (int s = 0; s < N_S; s++) {
+            res.offset[s + 1] += res.offset[s];
+        }
+        for (int s : NFA.final_states) {
+            res.final_states.set(s);
+        }
+        res.accepting_states = find_accepting_states(res);
+        return res;
+    }
+
+    static constexpr auto res = build();
+};
+
+#endif
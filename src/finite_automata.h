@@ -2,39 +2,65 @@
 #define CTRE_FINITE_AUTOMATA_H
 
 #include "array.h"
+#include "bitset.h"
+#include "flat_parser.h"
 #include "parse_table.h"  // for AST types
 #include <iostream>
 
+// Matches the bytes lo to hi, an epsilon transition has the empty range
 struct transition {
-    int  src;
-    int  dst;
-    char char_to_match;
-    bool is_epsilon;
+    int           src;
+    int           dst;
+    unsigned char lo;
+    unsigned char hi;
+    bool          is_epsilon;
 
-    constexpr transition(int src = -1, int dst = -1, char c = '\0')
-        : src(src), dst(dst), char_to_match(c), is_epsilon(c == '\0') {}
+    constexpr transition(int src = -1, int dst = -1)
+        : src(src), dst(dst), lo(1), hi(0), is_epsilon(true) {}
+
+    constexpr transition(int src, int dst, char c)
+        : src(src), dst(dst), lo(static_cast<unsigned char>(c)), hi(static_cast<unsigned char>(c)), is_epsilon(false) {}
+
+    constexpr transition(int src, int dst, unsigned char lo, unsigned char hi)
+        : src(src), dst(dst), lo(lo), hi(hi), is_epsilon(false) {}
 
     constexpr bool match(char c) const {
-        return c == char_to_match;
+        unsigned char b = static_cast<unsigned char>(c);
+        return b >= lo && b <= hi;
     }
 
     void print() const {
         if (is_epsilon)
             printf("%d --epsilon--> %d\n", src, dst);
+        else if (lo == hi)
+            printf("%d --%c--> %d\n", src, lo, dst);
         else
-            printf("%d --%c--> %d\n", src, char_to_match, dst);
+            printf("%d --[%c-%c]--> %d\n", src, lo, hi, dst);
     }
 };
 
 // Stores 2 sorted int arrays as FA representation
 // constexpr-ly constructed from AST
 // Use lower_idx_in_trans to get the left most transition that originates from src state in the array
-template <int N_T, int N_FS>
+// EPSILON_FREE marks FAs without epsilon transitions so engines can skip looking for them
+//
+// The connectors below leave their results in construction order, sorting
+// only pays off once an engine binary-searches the arrays. Call sort() once
+// on the final FA, FA_remove_epsilon and FA_union do.
+template <int N_T, int N_FS, bool EPSILON_FREE = false>
 class finite_automata {
   private:
     int idx_t = 0, idx_fs = 0;
+    // highest state number seen + 1, kept up to date by add_*
+    int n_states = 0;
+
+    constexpr void see_state(int s) {
+        n_states = s + 1 > n_states ? s + 1 : n_states;
+    }
 
   public:
+    static constexpr bool epsilon_free = EPSILON_FREE;
+
     array<transition, N_T> transitions;
     array<int, N_FS>       final_states;
 
@@ -42,11 +68,18 @@ class finite_automata {
 
     constexpr finite_automata(array<transition, N_T> t, array<int, N_FS> fs)
         : transitions(t), final_states(fs) {
+        for (const transition& tr : transitions) {
+            see_state(tr.src);
+            see_state(tr.dst);
+        }
+        for (int s : final_states) {
+            see_state(s);
+        }
         this->sort();
     }
 
-    constexpr finite_automata(const finite_automata<N_T, N_FS>& other)
-        : transitions(other.transitions), final_states(other.final_states), idx_t(other.idx_t), idx_fs(other.idx_fs) {}
+    constexpr finite_automata(const finite_automata& other)
+        : idx_t(other.idx_t), idx_fs(other.idx_fs), n_states(other.n_states), transitions(other.transitions), final_states(other.final_states) {}
 
     constexpr int size_transition() const {
         return N_T;
@@ -60,21 +93,21 @@ class finite_automata {
     constexpr void add_transition(const transition& t) {
         transitions[idx_t] = t;
         idx_t++;
+        see_state(t.src);
+        see_state(t.dst);
     }
 
     // only use this when the object is default constructed
     constexpr void add_final_state(int fs) {
         final_states[idx_fs] = fs;
         idx_fs++;
+        see_state(fs);
     }
 
+    // a state may have no transitions at all, e.g. FA_epsilon, so final
+    // states count too
     constexpr int state_count() const {
-        int max = -1;
-        for (const transition& t : transitions) {
-            int tmp = t.src > t.dst ? t.src : t.dst;
-            max     = tmp > max ? tmp : max;
-        }
-        return max + 1;
+        return n_states;
     }
 
     constexpr void sort() {
@@ -152,6 +185,19 @@ static constexpr finite_automata<0, 1> FA_epsilon{ {}, { 0 } };
 template <char C>
 static constexpr finite_automata<1, 1> FA_char{ { { { 0, 1, C } } }, { 1 } };
 
+// one transition per maximal range of SET
+template <auto& SET>
+struct FA_bytes {
+    static constexpr auto f() {
+        finite_automata<range_count(SET), 1> res;
+        for_each_range(SET, [&](unsigned char lo, unsigned char hi) { res.add_transition({ 0, 1, lo, hi }); });
+        res.add_final_state(1);
+        return res;
+    }
+
+    static constexpr auto res = f();
+};
+
 //
 // FA connector
 //
@@ -159,115 +205,357 @@ static constexpr finite_automata<1, 1> FA_char{ { { { 0, 1, C } } }, { 1 } };
 // Wraps connector funtions in a struct and store the result in a static member.
 // This forces compiler to compute the results in compile time.
 // It is also eaiser to implement variadic connector APIs for concat and alt using this method.
+//
+// Variadic connectors join all of their operands in a single pass, so
+// a concat of n characters is one FA_concat rather than n - 1 nested ones,
+// each copying everything built so far.
 
-template <auto& LHS, auto& RHS, auto&... FAs>
-struct FA_concat {
-    template <int N_T1, int N_FS1, int N_T2, int N_FS2>
-    static constexpr auto f(const finite_automata<N_T1, N_FS1>& lhs, const finite_automata<N_T2, N_FS2>& rhs) {
-        finite_automata<N_T1 + N_T2 + N_FS1, N_FS2> res;
-        int                                         l_st_cnt = lhs.state_count();
+// offset[i] is the first state of FAs[i] when they are laid out one after
+// another from state FIRST on, so the states of FAs[i] are
+// [offset[i], offset[i + 1]).
+template <int FIRST, auto&... FAs>
+constexpr auto FA_offsets() {
+    constexpr int         count    = sizeof...(FAs);
+    int                   st_cnt[] = { FAs.state_count()... };
+    array<int, count + 1> res;
 
-        // copy lhs's transitions
-        for (transition t : lhs.transitions) {
-            res.add_transition(t);
-        }
+    res[0] = FIRST;
+    for (int i = 0; i < count; i++) {
+        res[i + 1] = res[i] + st_cnt[i];
+    }
+    return res;
+}
 
-        // copy rhs's transitions
-        for (transition t : rhs.transitions) {
-            t.src += l_st_cnt;
-            t.dst += l_st_cnt;
-            res.add_transition(t);
-        }
+template <auto&... FAs>
+struct FA_concat {
+    static constexpr int count = sizeof...(FAs);
 
-        // connect lhs's final states to rhs
-        for (int fs : lhs.final_states) {
-            res.add_transition({ fs, l_st_cnt });
-        }
+    static constexpr auto offset = FA_offsets<0, FAs...>();
 
-        // copy final states
-        for (int fs : rhs.final_states) {
-            res.add_final_state(fs + l_st_cnt);
+    // every final state but the last FA's gets an epsilon transition
+    static constexpr int n_links() {
+        int n_fs[] = { FAs.size_final_state()... };
+        int res    = 0;
+        for (int i = 0; i + 1 < count; i++) {
+            res += n_fs[i];
         }
-
-        res.sort();
         return res;
     }
 
-    template <typename T1, typename T2, typename... Ts>
-    static constexpr auto f(T1 t1, T2 t2, Ts... ts) {
-        return f(f(t1, t2), ts...);
+    static constexpr int n_last_fs() {
+        int n_fs[] = { FAs.size_final_state()... };
+        return n_fs[count - 1];
+    }
+
+    static constexpr auto f() {
+        finite_automata<(FAs.size_transition() + ...) + n_links(), n_last_fs()> res;
+        int                                                                 i = 0;
+
+        ([&](const auto& fa) {
+            for (transition t : fa.transitions) {
+                t.src += offset[i];
+                t.dst += offset[i];
+                res.add_transition(t);
+            }
+
+            // connect final states to the next FA, or keep them if this is the last one
+            for (int fs : fa.final_states) {
+                if (i + 1 < count)
+                    res.add_transition({ fs + offset[i], offset[i + 1] });
+                else
+                    res.add_final_state(fs + offset[i]);
+            }
+            i++;
+        }(FAs),
+         ...);
+
+        return res;
     }
 
-    static constexpr auto res = f(LHS, RHS, FAs...);
+    static constexpr auto res = f();
 };
 
-template <auto& LHS, auto& RHS, auto&... FAs>
+// Flat alternation of any number of FAs, a fresh starting state branches
+// into each of them. Merging the starting states instead is wrong as soon
+// as one of them has incoming transitions, e.g. a*|b would accept "ab".
+template <auto&... FAs>
 struct FA_alter {
-    template <int N_T1, int N_FS1, int N_T2, int N_FS2>
-    static constexpr auto f(const finite_automata<N_T1, N_FS1>& lhs, const finite_automata<N_T2, N_FS2>& rhs) {
-        finite_automata<N_T1 + N_T2, N_FS1 + N_FS2> res;
-        int                                         l_st_cnt = lhs.state_count();
+    static constexpr int count = sizeof...(FAs);
 
-        // copy lhs's transitions
-        for (transition t : lhs.transitions) {
-            res.add_transition(t);
-        }
+    static constexpr auto offset = FA_offsets<1, FAs...>();
+
+    static constexpr auto f() {
+        finite_automata<(FAs.size_transition() + ...) + count, (FAs.size_final_state() + ...)> res;
+        int                                                                                 i = 0;
+
+        ([&](const auto& fa) {
+            res.add_transition({ 0, offset[i] });
+
+            for (transition t : fa.transitions) {
+                t.src += offset[i];
+                t.dst += offset[i];
+                res.add_transition(t);
+            }
+
+            for (int fs : fa.final_states) {
+                res.add_final_state(fs + offset[i]);
+            }
+            i++;
+        }(FAs),
+         ...);
+
+        return res;
+    }
+
+    static constexpr auto res = f();
+};
+
+template <auto& FA>
+struct FA_star {
+    template <int N_T, int N_FS>
+    static constexpr auto f(const finite_automata<N_T, N_FS>& fa) {
+        finite_automata<N_T + N_FS + 1, 1> res;
 
-        // copy rhs's transitions and merge starting states
-        for (transition t : rhs.transitions) {
-            if (t.src != 0)
-                t.src += l_st_cnt - 1;
-            if (t.dst != 0)
-                t.dst += l_st_cnt - 1;
+        // A fresh starting state, which is also the only final state.
+        // Looping back to fa's own starting state instead would let
+        // a partial match of fa count as a full one, e.g. (a*b)* would
+        // accept "a".
+        res.add_transition({ 0, 1 });
 
+        for (transition t : fa.transitions) {
+            t.src += 1;
+            t.dst += 1;
             res.add_transition(t);
         }
 
-        // copy final states
-        for (int fs : lhs.final_states) {
-            res.add_final_state(fs);
-        }
-        for (int fs : rhs.final_states) {
-            res.add_final_state(fs + l_st_cnt - 1);
+        for (int fs : fa.final_states) {
+            res.add_transition({ fs + 1, 0 });
         }
 
-        res.sort();
+        res.add_final_state(0);
+
         return res;
     }
 
-    template <typename T1, typename T2, typename... Ts>
-    static constexpr auto f(T1 t1, T2 t2, Ts... ts) {
-        return f(f(t1, t2), ts...);
+    static constexpr auto res = f(FA);
+};
+
+// MIN to MAX copies of FA in a row, 0 <= MIN <= MAX and MAX >= 1. Copy i
+// is entered through a gate state, and the gates from MIN on may skip to
+// the end:
+//
+//   gate 0 -> copy 0 -> gate 1 -> ... -> copy MAX - 1 -> end
+//
+// Each copy is one loop over FA's arrays, so x{1,500} is a single
+// template instantiation rather than 500 nested concats of x?, and every
+// state's epsilon closure stays a few states wide, which keeps the
+// epsilon-free NFA linear in MAX. That takes an FA that doesn't accept the
+// empty string, or every copy's closure runs through all the copies after
+// it, see build_FA(repeat<MIN, MAX, T>). Gates and the end state are only
+// entered through epsilon transitions, FA_remove_epsilon drops them. Gates
+// rather than copy i's own starting state because that state may be
+// reached from inside the copy, e.g. for x = a*b.
+template <auto& FA, int MIN, int MAX>
+struct FA_repeat {
+    static_assert(0 <= MIN && MIN <= MAX && MAX >= 1, "FA_repeat needs 0 <= MIN <= MAX, MAX >= 1");
+
+    template <int N_T, int N_FS>
+    static constexpr auto f(const finite_automata<N_T, N_FS>& fa) {
+        finite_automata<MAX * (N_T + N_FS + 1) + (MAX - MIN), 1> res;
+
+        int copy_states = fa.state_count() + 1;  // with its gate
+        int end         = MAX * copy_states;
+
+        for (int i = 0; i < MAX; i++) {
+            int gate = i * copy_states;
+            res.add_transition({ gate, gate + 1 });
+
+            for (transition t : fa.transitions) {
+                t.src += gate + 1;
+                t.dst += gate + 1;
+                res.add_transition(t);
+            }
+
+            // the next gate is the end after the last copy
+            for (int fs : fa.final_states) {
+                res.add_transition({ fs + gate + 1, gate + copy_states });
+            }
+
+            if (i >= MIN)
+                res.add_transition({ gate, end });
+        }
+
+        res.add_final_state(end);
+        return res;
     }
 
-    static constexpr auto res = f(LHS, RHS, FAs...);
+    static constexpr auto res = f(FA);
 };
 
+// Whether FA accepts the empty string, its starting state's epsilon
+// closure has a final state.
 template <auto& FA>
-struct FA_star {
+constexpr bool FA_accepts_empty() {
+    constexpr int N = FA.state_count();
+
+    bitset<N>     reached;
+    array<int, N> todo;
+    int           n_todo = 0;
+
+    reached.set(0);
+    todo[n_todo++] = 0;
+    while (n_todo > 0) {
+        int s = todo[--n_todo];
+        for (int fs : FA.final_states) {
+            if (fs == s)
+                return true;
+        }
+        for (const transition& t : FA.transitions) {
+            if (t.is_epsilon && t.src == s && !reached.test(t.dst)) {
+                reached.set(t.dst);
+                todo[n_todo++] = t.dst;
+            }
+        }
+    }
+    return false;
+}
+
+// FA without the empty string. Two layers of FA's states, the first for
+// nothing read yet and the second, numbered from FA.state_count() on, for
+// at least one byte read. Epsilon transitions stay within their layer,
+// byte transitions lead into the second one, whose final states are the
+// only final ones.
+template <auto& FA>
+struct FA_nonempty {
     template <int N_T, int N_FS>
     static constexpr auto f(const finite_automata<N_T, N_FS>& fa) {
-        finite_automata<N_T + N_FS, N_FS> res;
+        finite_automata<2 * N_T, N_FS> res;
+
+        int layer = fa.state_count();
+        for (transition t : fa.transitions) {
+            if (!t.is_epsilon)
+                t.dst += layer;
+            res.add_transition(t);
+        }
 
         for (transition t : fa.transitions) {
+            t.src += layer;
+            t.dst += layer;
             res.add_transition(t);
         }
 
         for (int fs : fa.final_states) {
-            res.add_transition({ fs, 0 });
+            res.add_final_state(fs + layer);
         }
+        return res;
+    }
+
+    static constexpr auto res = f(FA);
+};
 
+// The single normalization pass: FA with its arrays sorted.
+template <auto& FA>
+struct FA_sort {
+    static constexpr auto f() {
+        auto res = FA;
         res.sort();
         return res;
     }
 
-    static constexpr auto res = f(FA);
+    static constexpr auto res = f();
+};
+
+// FA_alter whose result is sorted, for engines that run on the union
+// directly. offset[i] is the first state of FAs[i].
+template <auto&... FAs>
+struct FA_union {
+    static constexpr int count = sizeof...(FAs);
+
+    static constexpr auto& offset = FA_alter<FAs...>::offset;
+
+    static constexpr auto& res = FA_sort<FA_alter<FAs...>::res>::res;
+};
+
+// FA_union of epsilon-free FAs that stays epsilon-free: instead of an
+// epsilon transition into each FA, the fresh starting state gets a copy of
+// the transitions out of each FA's starting state, and is final if one of
+// them is. offset[i] is the first state of FAs[i].
+template <auto&... FAs>
+struct FA_epsilon_free_union {
+    static_assert((FAs.epsilon_free && ...), "FA_epsilon_free_union joins epsilon-free FAs");
+
+    static constexpr int count = sizeof...(FAs);
+
+    static constexpr auto offset = FA_offsets<1, FAs...>();
+
+    static constexpr int start_transitions() {
+        int res = 0;
+        ([&](const auto& fa) {
+            for (const transition& t : fa.transitions) {
+                res += t.src == 0;
+            }
+        }(FAs),
+         ...);
+        return res;
+    }
+
+    // the patterns whose FA accepts the empty string
+    static constexpr bitset<count> build_start_final() {
+        bitset<count> res;
+        int           i = 0;
+        ([&](const auto& fa) {
+            for (int fs : fa.final_states) {
+                if (fs == 0)
+                    res.set(i);
+            }
+            i++;
+        }(FAs),
+         ...);
+        return res;
+    }
+
+    static constexpr bitset<count> start_final = build_start_final();
+
+    static constexpr auto f() {
+        constexpr int n_t  = (FAs.size_transition() + ...) + start_transitions();
+        constexpr int n_fs = (FAs.size_final_state() + ...) + (start_final.any() ? 1 : 0);
+
+        finite_automata<n_t, n_fs, true> res;
+        int                              i = 0;
+
+        if (start_final.any())
+            res.add_final_state(0);
+
+        ([&](const auto& fa) {
+            for (transition t : fa.transitions) {
+                if (t.src == 0)
+                    res.add_transition({ 0, t.dst + offset[i], t.lo, t.hi });
+
+                t.src += offset[i];
+                t.dst += offset[i];
+                res.add_transition(t);
+            }
+
+            for (int fs : fa.final_states) {
+                res.add_final_state(fs + offset[i]);
+            }
+            i++;
+        }(FAs),
+         ...);
+
+        res.sort();
+        return res;
+    }
+
+    static constexpr auto res = f();
 };
 
 //
 // FA builder
 //
 
+// Thompson construction over the AST. The result is in construction order,
+// see finite_automata.
 template <typename... Ts>
 constexpr auto& build_FA(concat<Ts...>) {
     return FA_concat<build_FA(Ts{})...>::res;
@@ -283,13 +571,1263 @@ constexpr auto& build_FA(star<T>) {
     return FA_star<build_FA(T{})>::res;
 }
 
+// x{MIN,} is x{MIN} x*. When x accepts the empty string so does every
+// copy, x{MIN,MAX} is x'{0,MAX} with x' x without the empty string, and
+// x{MIN,} is x*.
+template <int MIN, int MAX, typename T>
+constexpr auto& build_FA(repeat<MIN, MAX, T>) {
+    constexpr auto& fa = build_FA(T{});
+    if constexpr (MAX == 0)
+        return FA_epsilon;
+    else if constexpr (FA_accepts_empty<fa>() && MAX > 0)
+        return FA_repeat<FA_nonempty<fa>::res, 0, MAX>::res;
+    else if constexpr (FA_accepts_empty<fa>())
+        return FA_star<fa>::res;
+    else if constexpr (MAX > 0)
+        return FA_repeat<fa, MIN, MAX>::res;
+    else if constexpr (MIN == 0)
+        return FA_star<fa>::res;
+    else
+        return FA_concat<FA_repeat<fa, MIN, MIN>::res, FA_star<fa>::res>::res;
+}
+
 template <char C>
 constexpr auto& build_FA(ch<C>) {
     return FA_char<C>;
 }
 
+template <bool NEGATED, typename... Items>
+constexpr auto& build_FA(char_class<NEGATED, Items...>) {
+    return FA_bytes<class_set<char_class<NEGATED, Items...>>::res>::res;
+}
+
 constexpr auto& build_FA(epsilon) {
     return FA_epsilon;
 }
 
+// Thompson construction over a flat AST, laid out exactly like build_FA
+// would lay out the corresponding AST types. A sub-automaton's final states
+// are kept on a stack until its parent has connected them.
+template <auto& AST>
+struct flat_build_FA {
+    static_assert(AST.correct, "Regular expression syntax error");
+
+    // every node pushes at most two final states, n_opt two, the others one
+    using final_stack = array<int, 2 * AST.size + 1>;
+
+    template <typename Output>
+    static constexpr void link_finals(Output& out, final_stack& fs, int& n_fs, int base, int dst) {
+        for (int k = base; k < n_fs; k++) {
+            out.add_transition({ fs[k], dst });
+        }
+        n_fs = base;
+    }
+
+    // FA_star over the sub-automaton of node, returns its state count
+    template <typename Output>
+    static constexpr int emit_star(Output& out, final_stack& fs, int& n_fs, int node, int offset) {
+        out.add_transition({ offset, offset + 1 });
+
+        int base = n_fs;
+        int used = emit(out, fs, n_fs, node, offset + 1);
+        link_finals(out, fs, n_fs, base, offset);
+
+        fs[n_fs++] = offset;
+        return used + 1;
+    }
+
+    // Output whose byte transitions lead shift states further, the first
+    // layer of FA_nonempty. A layer within a layer shifts by the sum, so
+    // there is only ever one level of wrapping.
+    template <typename Output>
+    struct shifted_output {
+        Output& out;
+        int     shift;
+
+        constexpr void add_transition(transition t) {
+            if (!t.is_epsilon)
+                t.dst += shift;
+            out.add_transition(t);
+        }
+    };
+
+    template <typename Output>
+    static constexpr shifted_output<Output> shifted(Output& out, int shift) {
+        return { out, shift };
+    }
+
+    template <typename Output>
+    static constexpr shifted_output<Output> shifted(shifted_output<Output>& out, int shift) {
+        return { out.out, out.shift + shift };
+    }
+
+    // FA_nonempty over the sub-automaton of node, returns its state count
+    template <typename Output>
+    static constexpr int emit_nonempty(Output& out, final_stack& fs, int& n_fs, int node, int offset) {
+        counter     sizes;
+        final_stack unused;
+        int         n_unused = 0;
+        int         layer    = emit(sizes, unused, n_unused, node, offset);
+
+        auto first = shifted(out, layer);
+        int  base  = n_fs;
+        emit(first, fs, n_fs, node, offset);
+        n_fs = base;
+
+        emit(out, fs, n_fs, node, offset + layer);
+        return 2 * layer;
+    }
+
+    // whether node's sub-automaton accepts the empty string
+    static constexpr bool accepts_empty(int node) {
+        const flat_node& n = AST[node];
+
+        switch (n.kind) {
+        case flat_node::n_char:
+        case flat_node::n_class:
+            return false;
+        case flat_node::n_concat:
+            for (int child = n.first; child >= 0; child = AST[child].next) {
+                if (!accepts_empty(child))
+                    return false;
+            }
+            return true;
+        case flat_node::n_alter:
+            for (int child = n.first; child >= 0; child = AST[child].next) {
+                if (accepts_empty(child))
+                    return true;
+            }
+            return false;
+        case flat_node::n_plus:
+        case flat_node::n_capture:
+            return accepts_empty(n.first);
+        case flat_node::n_repeat:
+            return n.min == 0 || accepts_empty(n.first);
+        default:
+            return true;
+        }
+    }
+
+    // FA_repeat over the sub-automaton of node, or over its FA_nonempty
+    // with nonempty, 1 <= max
+    template <typename Output>
+    static constexpr int emit_repeat(Output& out, final_stack& fs, int& n_fs, int node, int offset, int min, int max, bool nonempty = false) {
+        int copy_states = 0;  // with its gate, known after the first copy
+        for (int i = 0; i < max; i++) {
+            int gate = offset + i * copy_states;
+            out.add_transition({ gate, gate + 1 });
+
+            int base    = n_fs;
+            copy_states = (nonempty ? emit_nonempty(out, fs, n_fs, node, gate + 1) : emit(out, fs, n_fs, node, gate + 1)) + 1;
+            link_finals(out, fs, n_fs, base, gate + copy_states);
+
+            if (i >= min)
+                out.add_transition({ gate, offset + max * copy_states });
+        }
+
+        fs[n_fs++] = offset + max * copy_states;
+        return max * copy_states + 1;
+    }
+
+    // Adds the sub-automaton of node, numbered from offset on, and pushes
+    // its final states. Returns its state count.
+    template <typename Output>
+    static constexpr int emit(Output& out, final_stack& fs, int& n_fs, int node, int offset) {
+        const flat_node& n = AST[node];
+
+        switch (n.kind) {
+        case flat_node::n_char:
+            out.add_transition({ offset, offset + 1, n.c });
+            fs[n_fs++] = offset + 1;
+            return 2;
+
+        case flat_node::n_class:
+            // FA_bytes
+            for_each_range(n.set, [&](unsigned char lo, unsigned char hi) { out.add_transition({ offset, offset + 1, lo, hi }); });
+            fs[n_fs++] = offset + 1;
+            return 2;
+
+        case flat_node::n_concat: {
+            // FA_concat, a concat of one is its child, of none FA_epsilon
+            if (n.first < 0)
+                break;
+
+            int st = 0;
+            for (int child = n.first; child >= 0; child = AST[child].next) {
+                int base = n_fs;
+                st += emit(out, fs, n_fs, child, offset + st);
+                if (AST[child].next >= 0)
+                    link_finals(out, fs, n_fs, base, offset + st);
+            }
+            return st;
+        }
+
+        case flat_node::n_alter: {
+            if (n.first == n.last)
+                return emit(out, fs, n_fs, n.first, offset);
+
+            // FA_alter
+            int st = 1;
+            for (int child = n.first; child >= 0; child = AST[child].next) {
+                out.add_transition({ offset, offset + st });
+                st += emit(out, fs, n_fs, child, offset + st);
+            }
+            return st;
+        }
+
+        case flat_node::n_star:
+            return emit_star(out, fs, n_fs, n.first, offset);
+
+        case flat_node::n_plus: {
+            // concat<T, star<T>>
+            int base = n_fs;
+            int used = emit(out, fs, n_fs, n.first, offset);
+            link_finals(out, fs, n_fs, base, offset + used);
+            return used + emit_star(out, fs, n_fs, n.first, offset + used);
+        }
+
+        case flat_node::n_opt: {
+            // alter<T, epsilon>
+            out.add_transition({ offset, offset + 1 });
+            int st = 1 + emit(out, fs, n_fs, n.first, offset + 1);
+            out.add_transition({ offset, offset + st });
+            fs[n_fs++] = offset + st;
+            return st + 1;
+        }
+
+        case flat_node::n_capture:
+            return emit(out, fs, n_fs, n.first, offset);
+
+        case flat_node::n_repeat: {
+            // see build_FA(repeat<MIN, MAX, T>)
+            if (n.max == 0)
+                break;
+            if (accepts_empty(n.first) && n.max > 0)
+                return emit_repeat(out, fs, n_fs, n.first, offset, 0, n.max, true);
+            if (accepts_empty(n.first))
+                return emit_star(out, fs, n_fs, n.first, offset);
+            if (n.max > 0)
+                return emit_repeat(out, fs, n_fs, n.first, offset, n.min, n.max);
+            if (n.min == 0)
+                return emit_star(out, fs, n_fs, n.first, offset);
+
+            int base = n_fs;
+            int used = emit_repeat(out, fs, n_fs, n.first, offset, n.min, n.min);
+            link_finals(out, fs, n_fs, base, offset + used);
+            return used + emit_star(out, fs, n_fs, n.first, offset + used);
+        }
+
+        default:
+            break;
+        }
+
+        // FA_epsilon
+        fs[n_fs++] = offset;
+        return 1;
+    }
+
+    // same as FA_remove_epsilon::counter
+    struct counter {
+        int n_t = 0, n_fs = 0;
+
+        constexpr void add_transition(const transition&) {
+            n_t++;
+        }
+
+        constexpr void add_final_state(int) {
+            n_fs++;
+        }
+    };
+
+    template <typename Output>
+    static constexpr void f(Output& out) {
+        final_stack fs;
+        int         n_fs = 0;
+
+        emit(out, fs, n_fs, 0, 0);
+        for (int k = 0; k < n_fs; k++) {
+            out.add_final_state(fs[k]);
+        }
+    }
+
+    static constexpr counter count() {
+        counter res;
+        f(res);
+        return res;
+    }
+
+    static constexpr counter sizes = count();
+
+    static constexpr auto build() {
+        finite_automata<sizes.n_t, sizes.n_fs> res;
+        f(res);
+        return res;
+    }
+
+    static constexpr auto res = build();
+};
+
+//
+// Transitions by state
+//
+
+// The transitions of every state, counting-sorted by source so the FA's
+// transitions need not be sorted. Epsilon targets of state s are
+// eps_dst[eps_offset[s], eps_offset[s + 1]), its character transitions are
+// FA.transitions[char_idx[char_offset[s], char_offset[s + 1])].
+template <auto& FA>
+struct FA_edges {
+    static constexpr int N   = FA.state_count();
+    static constexpr int N_T = FA.size_transition() ? FA.size_transition() : 1;
+
+    struct table {
+        array<int, N + 1> eps_offset;
+        array<int, N_T>   eps_dst;
+        array<int, N + 1> char_offset;
+        array<int, N_T>   char_idx;
+    };
+
+    static constexpr table build() {
+        table res;
+        for (const transition& t : FA.transitions) {
+            if (t.is_epsilon)
+                res.eps_offset[t.src + 1]++;
+            else
+                res.char_offset[t.src + 1]++;
+        }
+        for (int s = 0; s < N; s++) {
+            res.eps_offset[s + 1] += res.eps_offset[s];
+            res.char_offset[s + 1] += res.char_offset[s];
+        }
+
+        array<int, N + 1> eps_fill  = res.eps_offset;
+        array<int, N + 1> char_fill = res.char_offset;
+        for (int i = 0; i < FA.size_transition(); i++) {
+            const transition& t = FA.transitions[i];
+            if (t.is_epsilon)
+                res.eps_dst[eps_fill[t.src]++] = t.dst;
+            else
+                res.char_idx[char_fill[t.src]++] = i;
+        }
+        return res;
+    }
+
+    static constexpr table res = build();
+};
+
+//
+// Epsilon elimination
+//
+
+// Replaces every state's epsilon closure by direct transitions: s --c--> d
+// for every q in closure(s) with q --c--> d. s is final if its closure
+// contains a final state. Only states reachable from state 0 are kept and
+// they are renumbered in breadth first order, so state 0 stays the start.
+// States that used to be entered only through epsilon transitions disappear.
+// build_FA gives every character transition its own target state, so no
+// duplicate transitions are produced.
+template <auto& NFA>
+struct FA_remove_epsilon {
+    static constexpr int N = NFA.state_count();
+
+    using state_set = bitset<N>;
+
+    static constexpr auto& edge = FA_edges<NFA>::res;
+
+    // Closures are only needed for the states that survive, and are built
+    // one at a time with a depth first walk, so memory stays O(N).
+    struct closure_walk {
+        state_set     visited;
+        array<int, N> members;
+        int           size = 0;
+
+        constexpr void walk(int s) {
+            for (int i = 0; i < size; i++) {
+                visited.reset(members[i]);
+            }
+            size = 0;
+
+            visited.set(s);
+            members[size++] = s;
+            for (int k = 0; k < size; k++) {
+                int q = members[k];
+                for (int i = edge.eps_offset[q]; i < edge.eps_offset[q + 1]; i++) {
+                    if (!visited.test(edge.eps_dst[i])) {
+                        visited.set(edge.eps_dst[i]);
+                        members[size++] = edge.eps_dst[i];
+                    }
+                }
+            }
+        }
+    };
+
+    static constexpr state_set nfa_final_states() {
+        state_set res;
+        for (int fs : NFA.final_states) {
+            res.set(fs);
+        }
+        return res;
+    }
+
+    struct counter {
+        int n_t = 0, n_fs = 0;
+
+        constexpr void add_transition(const transition&) {
+            n_t++;
+        }
+
+        constexpr void add_final_state(int) {
+            n_fs++;
+        }
+    };
+
+    template <typename Output>
+    static constexpr void f(Output& out) {
+        constexpr auto finals = nfa_final_states();
+
+        // new state number -> old state number
+        array<int, N> order;
+        // old state number -> new state number
+        array<int, N> renumbered;
+        int           n = 1;
+
+        for (int s = 0; s < N; s++) {
+            renumbered[s] = -1;
+        }
+        order[0]      = 0;
+        renumbered[0] = 0;
+
+        closure_walk cl;
+        for (int i = 0; i < n; i++) {
+            cl.walk(order[i]);
+
+            bool is_final = false;
+            for (int k = 0; k < cl.size; k++) {
+                is_final = is_final || finals.test(cl.members[k]);
+            }
+            if (is_final)
+                out.add_final_state(i);
+
+            for (int k = 0; k < cl.size; k++) {
+                int q = cl.members[k];
+                for (int j = edge.char_offset[q]; j < edge.char_offset[q + 1]; j++) {
+                    const transition& t = NFA.transitions[edge.char_idx[j]];
+
+                    if (renumbered[t.dst] < 0) {
+                        renumbered[t.dst] = n;
+                        order[n]          = t.dst;
+                        n++;
+                    }
+                    out.add_transition({ i, renumbered[t.dst], t.lo, t.hi });
+                }
+            }
+        }
+    }
+
+    static constexpr counter count() {
+        counter res;
+        f(res);
+        return res;
+    }
+
+    static constexpr counter sizes = count();
+
+    static constexpr auto build() {
+        finite_automata<sizes.n_t, sizes.n_fs, true> res;
+        f(res);
+        res.sort();
+        return res;
+    }
+
+    static constexpr auto res = build();
+};
+
+// epsilon-free counterpart of build_FA
+template <typename AST>
+constexpr auto& build_epsilon_free_FA(AST) {
+    return FA_remove_epsilon<build_FA(AST{})>::res;
+}
+
+//
+// Reversal
+//
+
+// Accepts the reversed strings of NFA's language. A fresh starting state
+// branches into every old final state and the old starting state becomes
+// the only final state.
+template <auto& NFA>
+struct FA_reverse {
+    template <int N_T, int N_FS, bool EF>
+    static constexpr auto f(const finite_automata<N_T, N_FS, EF>& fa) {
+        finite_automata<N_T + N_FS, 1> res;
+
+        for (const transition& t : fa.transitions) {
+            if (t.is_epsilon)
+                res.add_transition({ t.dst + 1, t.src + 1 });
+            else
+                res.add_transition({ t.dst + 1, t.src + 1, t.lo, t.hi });
+        }
+
+        for (int fs : fa.final_states) {
+            res.add_transition({ 0, fs + 1 });
+        }
+
+        res.add_final_state(1);
+
+        return res;
+    }
+
+    static constexpr auto res = f(NFA);
+};
+
+//
+// DFA
+//
+
+// Byte equivalence classes. Two bytes that every transition of an FA either
+// matches or doesn't are interchangeable, so the DFA needs a column per
+// class rather than per byte. The classes are the runs of bytes between
+// the ends of the transitions' ranges, numbered in byte order: "abc" has
+// five of them, . has three. Bytes no transition matches form classes of
+// their own, which lead to the dead state.
+struct byte_classes {
+    array<unsigned char, 256> of;  // class of every byte
+    int                       count = 1;
+
+    // columns of a DFA row, the next power of two so rows are indexed by a
+    // shift
+    constexpr int stride_bits() const {
+        int res = 0;
+        while ((1 << res) < count) {
+            res++;
+        }
+        return res;
+    }
+
+    constexpr int stride() const {
+        return 1 << stride_bits();
+    }
+
+    // the first byte of every class, for stepping an FA over a class
+    constexpr array<unsigned char, 256> representatives() const {
+        array<unsigned char, 256> res;
+        for (int c = 255; c >= 0; c--) {
+            res[of[c]] = static_cast<unsigned char>(c);
+        }
+        return res;
+    }
+};
+
+// the classes of a list of transitions, or of anything else with byte
+// ranges lo to hi, empty ranges are skipped
+template <typename Edges>
+constexpr byte_classes make_byte_classes(const Edges& edges) {
+    // a new class starts at every lo and after every hi
+    bitset<256> starts;
+    for (const auto& e : edges) {
+        if (e.lo > e.hi)
+            continue;
+        starts.set(e.lo);
+        if (e.hi < 255)
+            starts.set(e.hi + 1);
+    }
+
+    byte_classes res;
+    int          cls = 0;
+    for (int c = 0; c < 256; c++) {
+        if (c > 0 && starts.test(c))
+            cls++;
+        res.of[c] = static_cast<unsigned char>(cls);
+    }
+    res.count = cls + 1;
+    return res;
+}
+
+// Dense DFA, one row of next states per state indexed by the byte class of
+// the input byte. State 0 is the dead state (the empty set of NFA states),
+// state 1 is the starting state. Matching is a class lookup, which doesn't
+// depend on the state, and one table load per input byte. STRIDE is the
+// row length, a power of two of at least classes.count.
+template <int N_S, int STRIDE>
+class deterministic_automata {
+  public:
+    static constexpr int dead_state  = 0;
+    static constexpr int start_state = 1;
+
+    array<int, N_S * STRIDE> transitions;
+    bitset<N_S>              final_states;
+    byte_classes             classes;
+
+    // A final state that loops on every byte accepts whatever follows, so
+    // like the dead state it decides the match. dead_state if there is none.
+    // After FA_minimize it is the only state that accepts everything, as the
+    // dead state is the only one that accepts nothing.
+    int accepting_state = dead_state;
+
+    static constexpr int stride = STRIDE;
+
+    constexpr int state_count() const {
+        return N_S;
+    }
+
+    constexpr int class_count() const {
+        return classes.count;
+    }
+
+    constexpr int next(int state, unsigned char c) const {
+        return transitions[state * STRIDE + classes.of[c]];
+    }
+
+    constexpr int next_class(int state, int cls) const {
+        return transitions[state * STRIDE + cls];
+    }
+
+    constexpr bool is_final_state(int state) const {
+        return final_states.test(state);
+    }
+
+    // no input that follows can change whether the input matches
+    constexpr bool is_decided(int state) const {
+        return state == dead_state || state == accepting_state;
+    }
+
+    // used by FA_determinize
+    constexpr void add_transition(int src, int cls, int dst) {
+        transitions[src * STRIDE + cls] = dst;
+    }
+
+    // used by FA_determinize
+    constexpr void add_final_state(int state) {
+        final_states.set(state);
+    }
+
+    // used by FA_determinize once the table is filled
+    constexpr void find_accepting_state() {
+        for (int s = 0; s < N_S; s++) {
+            bool loops = is_final_state(s);
+            for (int k = 0; k < classes.count && loops; k++) {
+                loops = next_class(s, k) == s;
+            }
+            if (loops) {
+                accepting_state = s;
+                return;
+            }
+        }
+    }
+
+    void print() const {
+        for (int s = 0; s < N_S; s++) {
+            for (int c = 0; c < 256; c++) {
+                if (next(s, c) != dead_state)
+                    printf("%d --%c--> %d\n", s, c, next(s, c));
+            }
+        }
+        printf("Final States: ");
+        for (int s = 0; s < N_S; s++) {
+            if (is_final_state(s))
+                printf("%d ", s);
+        }
+        printf("\n\n");
+    }
+};
+
+// Subset constructions whose worst case, MAX_STATES DFA states times the
+// byte classes times one step over the NFA, exceeds this many units of work are
+// not attempted. Running them would exhaust the compiler's constexpr
+// operation limit (2^25 by default in GCC) on long patterns, instead of
+// falling back to another engine.
+static constexpr long determinize_budget = 1 << 21;
+
+// The worst case is far off for most patterns, so the ones that are
+// attempted count the work actually done, an NFA transition looked at or a
+// state compared, and give up past this many units. A unit is a few
+// hundred constexpr operations. Large counts in {m,n} get here, .{0,256}
+// steps over most of its NFA on every byte.
+static constexpr long determinize_work_limit = 1 << 16;
+
+// Subset construction. The number of DFA states is only known after running
+// it, so it runs twice: once to count the states, once to fill a table of
+// exactly that size. Patterns that need more than MAX_STATES DFA states, or
+// are too large to try, are not determinized, check `fits` before using
+// `res`.
+template <auto& NFA, int MAX_STATES = 256>
+struct FA_determinize {
+    static constexpr int nfa_state_count = NFA.state_count();
+
+    using state_set = bitset<nfa_state_count>;
+
+    static constexpr auto& edge = FA_edges<NFA>::res;
+
+    // follow epsilon transitions from every state in set
+    static constexpr void close(state_set& set) {
+        if constexpr (NFA.epsilon_free)
+            return;
+
+        array<int, nfa_state_count> work;
+        int                         n = 0;
+        for (int s = 0; s < nfa_state_count; s++) {
+            if (set.test(s))
+                work[n++] = s;
+        }
+        while (n > 0) {
+            int q = work[--n];
+            for (int i = edge.eps_offset[q]; i < edge.eps_offset[q + 1]; i++) {
+                if (!set.test(edge.eps_dst[i])) {
+                    set.set(edge.eps_dst[i]);
+                    work[n++] = edge.eps_dst[i];
+                }
+            }
+        }
+    }
+
+    // only the transitions of states in set are looked at, they count
+    // towards work
+    static constexpr state_set step(const state_set& set, char c, long& work) {
+        state_set res;
+        for (int w = 0; w < state_set::n_words; w++) {
+            for (uint64_t x = set.words[w]; x; x &= x - 1) {
+                int q = w * 64 + __builtin_ctzll(x);
+                work += edge.char_offset[q + 1] - edge.char_offset[q];
+                for (int i = edge.char_offset[q]; i < edge.char_offset[q + 1]; i++) {
+                    const transition& t = NFA.transitions[edge.char_idx[i]];
+                    if (t.match(c))
+                        res.set(t.dst);
+                }
+            }
+        }
+        close(res);
+        return res;
+    }
+
+    // the DFA steps over one byte of every class
+    static constexpr byte_classes classes = make_byte_classes(NFA.transitions);
+    static constexpr int          stride  = classes.stride();
+
+    static constexpr state_set nfa_final_states() {
+        state_set res;
+        for (int fs : NFA.final_states) {
+            res.set(fs);
+        }
+        return res;
+    }
+
+    // discards everything, used for counting
+    struct null_output {
+        constexpr void add_transition(int, int, int) {}
+        constexpr void add_final_state(int) {}
+    };
+
+    // returns the number of DFA states, or -1 if there are more than CAP or
+    // they cost more than determinize_work_limit. sets receives the NFA
+    // states behind every DFA state.
+    template <int CAP, typename Output>
+    static constexpr int f(Output& out, array<state_set, CAP>& sets) {
+        int  n    = 2;
+        long work = 0;
+
+        // sets[0] stays empty for the dead state
+        sets[1].set(0);
+        close(sets[1]);
+
+        // compared before the sets themselves when looking a set up
+        array<uint64_t, CAP> hashes;
+        hashes[0] = sets[0].hash();
+        hashes[1] = sets[1].hash();
+
+        constexpr auto rep    = classes.representatives();
+        constexpr auto finals = nfa_final_states();
+
+        for (int i = 1; i < n; i++) {
+            if (sets[i].intersects(finals))
+                out.add_final_state(i);
+
+            for (int k = 0; k < classes.count; k++) {
+                state_set next = step(sets[i], static_cast<char>(rep[k]), work);
+                uint64_t  h    = next.hash();
+
+                int j = 0;
+                while (j < n && (hashes[j] != h || sets[j] != next)) {
+                    j++;
+                }
+                work += state_set::n_words + j;
+                if (work > determinize_work_limit)
+                    return -1;
+                if (j == n) {
+                    if (n == CAP)
+                        return -1;
+                    sets[n]   = next;
+                    hashes[n] = h;
+                    n++;
+                }
+
+                out.add_transition(i, k, j);
+            }
+        }
+        return n;
+    }
+
+    static constexpr bool affordable =
+        long(MAX_STATES) * classes.count * (NFA.size_transition() + state_set::n_words) <= determinize_budget;
+
+    static constexpr int count() {
+        if constexpr (!affordable) {
+            return -1;
+        } else {
+            null_output                  out;
+            array<state_set, MAX_STATES> sets;
+            return f(out, sets);
+        }
+    }
+
+    static constexpr int state_count = count();
+
+    static constexpr bool fits = state_count > 0;
+
+    static constexpr auto build() {
+        deterministic_automata<fits ? state_count : 2, stride> res;
+        res.classes = classes;
+        if constexpr (fits) {
+            array<state_set, state_count> sets;
+            f(res, sets);
+        }
+        res.find_accepting_state();
+        return res;
+    }
+
+    static constexpr auto res = build();
+
+    // the NFA states behind every DFA state, for callers that need more
+    // than finality
+    static constexpr auto build_subsets() {
+        array<state_set, fits ? state_count : 2> sets;
+        if constexpr (fits) {
+            null_output out;
+            f(out, sets);
+        }
+        return sets;
+    }
+
+    static constexpr auto subsets = build_subsets();
+};
+
+// Subset construction for unanchored leftmost-longest search over an
+// epsilon-free NFA. A new thread starts at every input position, and a DFA
+// state keeps the active NFA states grouped by the position their thread
+// started at, earliest first. An NFA state reached by two threads is only
+// kept in the earlier group, it has the same future either way.
+//
+// Once a group reaches a final state, later groups can only produce matches
+// that start further right, so they are dropped and no new threads are
+// started. The DFA then runs on until it dies, and the last position where
+// it accepted is the end of the leftmost-longest match.
+template <auto& NFA, int MAX_STATES = 256>
+struct FA_determinize_leftmost {
+    static_assert(NFA.epsilon_free, "FA_determinize_leftmost needs an epsilon-free FA");
+
+    static constexpr int nfa_state_count = NFA.state_count();
+
+    static constexpr auto& edge = FA_edges<NFA>::res;
+
+    struct threads {
+        // group of every NFA state, -1 if inactive
+        array<int, nfa_state_count> group;
+        // whether new threads are still started
+        bool restart = false;
+
+        constexpr bool operator!=(const threads& other) const {
+            if (restart != other.restart)
+                return true;
+            for (int i = 0; i < nfa_state_count; i++) {
+                if (group[i] != other.group[i])
+                    return true;
+            }
+            return false;
+        }
+
+        constexpr uint64_t hash() const {
+            uint64_t res = 0xcbf29ce484222325 ^ restart;
+            for (int i = 0; i < nfa_state_count; i++) {
+                res = (res ^ static_cast<uint64_t>(group[i] + 1)) * 0x100000001b3;
+            }
+            return res;
+        }
+    };
+
+    static constexpr threads dead() {
+        threads res;
+        for (int i = 0; i < nfa_state_count; i++) {
+            res.group[i] = -1;
+        }
+        return res;
+    }
+
+    // drops groups after the first one that reached a final state
+    static constexpr void cut(threads& th) {
+        int matched = -1;
+        for (int fs : NFA.final_states) {
+            if (th.group[fs] >= 0 && (matched < 0 || th.group[fs] < matched))
+                matched = th.group[fs];
+        }
+        if (matched < 0)
+            return;
+
+        for (int i = 0; i < nfa_state_count; i++) {
+            if (th.group[i] > matched)
+                th.group[i] = -1;
+        }
+        th.restart = false;
+    }
+
+    static constexpr threads start() {
+        threads res  = dead();
+        res.group[0] = 0;
+        res.restart  = true;
+        cut(res);
+        return res;
+    }
+
+    // An NFA state reached from several groups joins the earliest one, and
+    // the groups that survive are renumbered from 0 in their old order.
+    // O(N + T) rather than one pass over the transitions per group, each
+    // state and transition counts towards work.
+    static constexpr threads step(const threads& from, char c, long& work) {
+        threads res = dead();
+        int     n   = 0;
+
+        work += 8 * nfa_state_count;
+        for (int q = 0; q < nfa_state_count; q++) {
+            int g = from.group[q];
+            if (g < 0)
+                continue;
+
+            work += edge.char_offset[q + 1] - edge.char_offset[q];
+            for (int i = edge.char_offset[q]; i < edge.char_offset[q + 1]; i++) {
+                const transition& t = NFA.transitions[edge.char_idx[i]];
+                if (t.match(c) && (res.group[t.dst] < 0 || g < res.group[t.dst]))
+                    res.group[t.dst] = g;
+            }
+        }
+
+        array<int, nfa_state_count> rank;
+        for (int i = 0; i < nfa_state_count; i++) {
+            rank[i] = -1;
+        }
+        for (int i = 0; i < nfa_state_count; i++) {
+            if (res.group[i] >= 0)
+                rank[res.group[i]] = 0;
+        }
+        for (int g = 0; g < nfa_state_count; g++) {
+            if (rank[g] >= 0)
+                rank[g] = n++;
+        }
+        for (int i = 0; i < nfa_state_count; i++) {
+            if (res.group[i] >= 0)
+                res.group[i] = rank[res.group[i]];
+        }
+
+        res.restart = from.restart;
+        cut(res);
+        if (res.restart && res.group[0] < 0)
+            res.group[0] = n;
+        return res;
+    }
+
+    static constexpr bool accepting(const threads& th) {
+        for (int fs : NFA.final_states) {
+            if (th.group[fs] >= 0)
+                return true;
+        }
+        return false;
+    }
+
+    // see FA_determinize
+    static constexpr byte_classes classes = make_byte_classes(NFA.transitions);
+    static constexpr int          stride  = classes.stride();
+
+    // same as FA_determinize::null_output
+    struct null_output {
+        constexpr void add_transition(int, int, int) {}
+        constexpr void add_final_state(int) {}
+    };
+
+    // returns the number of DFA states, or -1 if there are more than CAP or
+    // they cost more than determinize_work_limit
+    template <int CAP, typename Output>
+    static constexpr int f(Output& out) {
+        array<threads, CAP> states;
+        int                 n    = 2;
+        long                work = 0;
+
+        // states[0] is the dead state
+        states[0] = dead();
+        states[1] = start();
+
+        // compared before the states themselves when looking a state up
+        array<uint64_t, CAP> hashes;
+        hashes[0] = states[0].hash();
+        hashes[1] = states[1].hash();
+
+        constexpr auto rep = classes.representatives();
+
+        for (int i = 1; i < n; i++) {
+            if (accepting(states[i]))
+                out.add_final_state(i);
+
+            for (int k = 0; k < classes.count; k++) {
+                threads  next = step(states[i], static_cast<char>(rep[k]), work);
+                uint64_t h    = next.hash();
+
+                int j = 0;
+                while (j < n && (hashes[j] != h || states[j] != next)) {
+                    j++;
+                }
+                work += j;
+                if (work > determinize_work_limit)
+                    return -1;
+                if (j == n) {
+                    if (n == CAP)
+                        return -1;
+                    states[n] = next;
+                    hashes[n] = h;
+                    n++;
+                }
+
+                out.add_transition(i, k, j);
+            }
+        }
+        return n;
+    }
+
+    // see determinize_budget
+    static constexpr bool affordable =
+        long(MAX_STATES) * classes.count * (NFA.size_transition() + 8 * nfa_state_count) <= determinize_budget;
+
+    static constexpr int count() {
+        if constexpr (!affordable) {
+            return -1;
+        } else {
+            null_output out;
+            return f<MAX_STATES>(out);
+        }
+    }
+
+    static constexpr int state_count = count();
+
+    static constexpr bool fits = state_count > 0;
+
+    static constexpr auto build() {
+        deterministic_automata<fits ? state_count : 2, stride> res;
+        res.classes = classes;
+        if constexpr (fits)
+            f<state_count>(res);
+        res.find_accepting_state();
+        return res;
+    }
+
+    static constexpr auto res = build();
+};
+
+// Partition refinement. States start out split by finality and blocks are
+// split until every state in a block agrees on the block reached by each
+// byte class. Numbering blocks by first appearance keeps the dead state at
+// 0 and the starting state at 1. The classes stay those of DFA.
+template <auto& DFA>
+struct FA_minimize {
+    static constexpr int N = DFA.state_count();
+
+    // byte classes that leave the dead state somewhere, all others agree
+    // everywhere
+    struct class_list {
+        array<int, 256> ids;
+        int             size = 0;
+    };
+
+    static constexpr class_list alphabet() {
+        class_list res;
+        for (int k = 0; k < DFA.class_count(); k++) {
+            for (int s = 0; s < N; s++) {
+                if (DFA.next_class(s, k) != DFA.dead_state) {
+                    res.ids[res.size++] = k;
+                    break;
+                }
+            }
+        }
+        return res;
+    }
+
+    static constexpr class_list ab = alphabet();
+    static constexpr int        A  = ab.size;
+
+    // the states that reach t on class ab.ids[i] are
+    // pred[offset[i * N + t]] .. pred[offset[i * N + t + 1] - 1]
+    struct inverse_edges {
+        array<int, A * N + 1> offset;
+        array<int, A * N + 1> pred;
+    };
+
+    static constexpr inverse_edges inverse() {
+        inverse_edges res;
+        for (int s = 0; s < N; s++) {
+            for (int i = 0; i < A; i++) {
+                res.offset[i * N + DFA.next_class(s, ab.ids[i]) + 1]++;
+            }
+        }
+        for (int k = 0; k < A * N; k++) {
+            res.offset[k + 1] += res.offset[k];
+        }
+
+        array<int, A * N + 1> fill = res.offset;
+        for (int s = 0; s < N; s++) {
+            for (int i = 0; i < A; i++) {
+                res.pred[fill[i * N + DFA.next_class(s, ab.ids[i])]++] = s;
+            }
+        }
+        return res;
+    }
+
+    // Hopcroft's refinement. Blocks are ranges of `elems`. A splitter block
+    // moves the predecessors of its states on each class to the front of
+    // their blocks, blocks that are only partly moved split in two. Only the
+    // smaller half of a split needs to become a splitter, so a chain of N
+    // states is done in N log N steps instead of Moore's N rounds.
+    static constexpr array<int, N> partition() {
+        constexpr inverse_edges inv = inverse();
+
+        array<int, N>  elems;
+        array<int, N>  pos;     // of every state in elems
+        array<int, N>  block;   // of every state
+        array<int, N>  first;   // of every block in elems
+        array<int, N>  size;    // of every block
+        array<int, N>  marked;  // states moved to the front of every block
+        array<bool, N> pending;
+        array<int, N>  worklist;
+        array<int, N>  splitter;
+        array<int, N>  touched;
+        int            block_cnt = 0;
+        int            n_work    = 0;
+
+        // non-final and final states
+        int n = 0;
+        for (int final = 0; final < 2; final++) {
+            int begin = n;
+            for (int s = 0; s < N; s++) {
+                if (DFA.is_final_state(s) == static_cast<bool>(final)) {
+                    elems[n] = s;
+                    pos[s]   = n++;
+                    block[s] = block_cnt;
+                }
+            }
+            if (n > begin) {
+                first[block_cnt]   = begin;
+                size[block_cnt]    = n - begin;
+                pending[block_cnt] = true;
+                worklist[n_work++] = block_cnt++;
+            }
+        }
+
+        while (n_work > 0) {
+            int S      = worklist[--n_work];
+            pending[S] = false;
+
+            // S may split while it is used
+            int n_splitter = size[S];
+            for (int k = 0; k < n_splitter; k++) {
+                splitter[k] = elems[first[S] + k];
+            }
+
+            for (int i = 0; i < A; i++) {
+                int n_touched = 0;
+                for (int k = 0; k < n_splitter; k++) {
+                    int key = i * N + splitter[k];
+                    for (int e = inv.offset[key]; e < inv.offset[key + 1]; e++) {
+                        int p     = inv.pred[e];
+                        int b     = block[p];
+                        int front = first[b] + marked[b];
+                        if (pos[p] < front)
+                            continue;
+
+                        if (marked[b] == 0)
+                            touched[n_touched++] = b;
+                        int q         = elems[front];
+                        elems[pos[p]] = q;
+                        pos[q]        = pos[p];
+                        elems[front]  = p;
+                        pos[p]        = front;
+                        marked[b]++;
+                    }
+                }
+
+                for (int j = 0; j < n_touched; j++) {
+                    int b     = touched[j];
+                    int m     = marked[b];
+                    marked[b] = 0;
+                    if (m == size[b])
+                        continue;
+
+                    int split    = block_cnt++;
+                    first[split] = first[b];
+                    size[split]  = m;
+                    first[b] += m;
+                    size[b] -= m;
+                    for (int k = first[split]; k < first[split] + m; k++) {
+                        block[elems[k]] = split;
+                    }
+
+                    int add = pending[b] || size[split] <= size[b] ? split : b;
+                    pending[add]       = true;
+                    worklist[n_work++] = add;
+                }
+            }
+        }
+
+        // number blocks by first appearance
+        array<int, N> number;
+        array<int, N> res;
+        int           cnt = 0;
+        for (int b = 0; b < N; b++) {
+            number[b] = -1;
+        }
+        for (int s = 0; s < N; s++) {
+            if (number[block[s]] < 0)
+                number[block[s]] = cnt++;
+            res[s] = number[block[s]];
+        }
+        return res;
+    }
+
+    static constexpr auto blocks = partition();
+
+    static constexpr int block_count() {
+        int max = 0;
+        for (int b : blocks) {
+            max = b > max ? b : max;
+        }
+        return max + 1;
+    }
+
+    static constexpr int original_state_count = N;
+
+    // the starting state may only be equivalent to the dead state if the
+    // language is empty, then state 1 is kept as an extra dead state
+    static constexpr int state_count = block_count() > 2 ? block_count() : 2;
+
+    static constexpr auto build() {
+        deterministic_automata<state_count, DFA.stride> res;
+        res.classes = DFA.classes;
+
+        for (int s = 0; s < N; s++) {
+            if (DFA.is_final_state(s))
+                res.add_final_state(blocks[s]);
+
+            for (int k = 0; k < DFA.class_count(); k++) {
+                res.add_transition(blocks[s], k, blocks[DFA.next_class(s, k)]);
+            }
+        }
+        res.find_accepting_state();
+        return res;
+    }
+
+    static constexpr auto res = build();
+};
+
 #endif
\ No newline at end of file
@@ -0,0 +1,314 @@
+#ifndef CTRE_FLAT_PARSER_H
+#define CTRE_FLAT_PARSER_H
+
+#include "array.h"
+#include "char_class.h"
+#include "fixed_string.h"
+#include "parse_table.h"  // for repeat_count
+
+// Value-based front end for long patterns. parser<> builds the AST as types
+// and recurses once per symbol, so patterns of a few hundred characters run
+// out of template depth. flat_parser reads the same grammar (see
+// parse_table.h) in a single loop and stores the AST as an array of nodes.
+// Children form a linked list, so a concatenation or alternation of any
+// length is walked without recursion. Only nesting, i.e. parentheses and
+// modifiers, recurses in the passes over the tree.
+
+struct flat_node {
+    enum node_kind { n_epsilon, n_char, n_class, n_concat, n_alter, n_star, n_plus, n_opt, n_repeat, n_capture };
+
+    node_kind kind  = n_epsilon;
+    char      c     = '\0';  // n_char
+    byte_set  set;           // n_class
+    int       group = -1;    // n_capture, counts from 0 in the order groups open
+    int       min   = 0;     // n_repeat
+    int       max   = 0;     // n_repeat, -1 for {min,}
+    int       first = -1;    // first child
+    int       last  = -1;    // last child
+    int       next  = -1;    // next sibling
+};
+
+// Node 0 is the root. On a syntax error `correct` is false and the nodes
+// are meaningless.
+template <int N>
+struct flat_AST {
+    array<flat_node, N> nodes;
+    int                 size        = 0;
+    int                 group_count = 0;
+    bool                correct     = true;
+
+    // array's const operator[] returns a copy, this one doesn't
+    constexpr const flat_node& operator[](int idx) const {
+        return nodes._data[idx];
+    }
+
+    constexpr flat_node& operator[](int idx) {
+        return nodes[idx];
+    }
+
+    constexpr int add(flat_node::node_kind kind, char c = '\0') {
+        nodes[size].kind = kind;
+        nodes[size].c    = c;
+        return size++;
+    }
+
+    constexpr void append_child(int parent, int child) {
+        if (nodes[parent].last < 0)
+            nodes[parent].first = child;
+        else
+            nodes[nodes[parent].last].next = child;
+        nodes[parent].last = child;
+    }
+};
+
+template <auto& fstr>
+class flat_parser {
+  private:
+    // an alter and a concat at the top, a capture, alter and concat per
+    // group, a concat per |, one node per character and per modifier.
+    // Exact unless there are escapes, classes or counts, they take one node
+    // for several characters.
+    static constexpr int node_count() {
+        int res = 2;
+        for (int i = 0; i < fstr.size(); i++) {
+            char c = fstr[i];
+            if (c == '(')
+                res += 3;
+            else if (c != ')')
+                res += 1;
+        }
+        return res;
+    }
+
+    static constexpr int capacity = node_count();
+
+    // Reads the body of a class from fstr[i] on, right after its [, into
+    // set. Returns the index of its ], -1 on a syntax error.
+    static constexpr int read_class(int i, byte_set& set) {
+        bool negated = i < fstr.size() && fstr[i] == '^';
+        i += negated;
+
+        byte_set res;
+        for (bool first = true;; first = false) {
+            if (i >= fstr.size() || (first && fstr[i] == ']'))
+                return -1;
+            if (fstr[i] == ']')
+                break;
+
+            // a byte or an escape, the escape may be a class of its own
+            int lo = static_cast<unsigned char>(fstr[i]);
+            if (fstr[i] == '\\') {
+                if (i + 1 >= fstr.size())
+                    return -1;
+                lo = escape_byte(fstr[i + 1]);
+                if (lo == -2)
+                    return -1;
+                i++;
+            }
+            i++;
+
+            // a - right before ] is a byte of its own
+            bool is_range = i + 1 < fstr.size() && fstr[i] == '-' && fstr[i + 1] != ']';
+            if (lo == -1) {
+                if (is_range)
+                    return -1;
+                res |= escape_set(fstr[i - 1]);
+                continue;
+            }
+            if (!is_range) {
+                res.set(lo);
+                continue;
+            }
+
+            i++;
+            int hi = static_cast<unsigned char>(fstr[i]);
+            if (fstr[i] == '\\') {
+                if (i + 1 >= fstr.size())
+                    return -1;
+                hi = escape_byte(fstr[i + 1]);
+                i++;
+            }
+            i++;
+            if (hi < lo)
+                return -1;
+            add_range(res, lo, hi);
+        }
+
+        set = negated ? complement(res) : res;
+        return i;
+    }
+
+    // Reads the counts of {m,n} from fstr[i] on, right after its {, into
+    // node. Returns the index of its }, -1 on a syntax error.
+    static constexpr int read_repeat(int i, flat_node& node) {
+        bool after_comma = false;
+        int  digits      = 0;
+        for (; i < fstr.size(); i++) {
+            char c = fstr[i];
+            if (c == ',' && !after_comma && digits > 0) {
+                after_comma = true;
+                digits      = 0;
+                continue;
+            }
+            if (c == '}' && (after_comma || digits > 0)) {
+                if (!after_comma)
+                    node.max = node.min;
+                else if (digits == 0)
+                    node.max = -1;
+                return node.max >= 0 && node.max < node.min ? -1 : i;
+            }
+
+            int& count = after_comma ? node.max : node.min;
+            count      = repeat_count(count, c);
+            if (count < 0)
+                return -1;
+            digits++;
+        }
+        return -1;
+    }
+
+    // Reads the character, ., escape or class at fstr[i] into node. Returns
+    // the index of its last character, -1 on a syntax error.
+    static constexpr int read_atom(int i, flat_node& node) {
+        char c = fstr[i];
+
+        if (c == '.') {
+            node.kind = flat_node::n_class;
+            node.set  = any_byte();
+            return i;
+        }
+        if (c == '[') {
+            node.kind = flat_node::n_class;
+            return read_class(i + 1, node.set);
+        }
+        if (c == '\\') {
+            if (i + 1 >= fstr.size())
+                return -1;
+            int b = escape_byte(fstr[i + 1]);
+            if (b == -2)
+                return -1;
+            if (b == -1) {
+                node.kind = flat_node::n_class;
+                node.set  = escape_set(fstr[i + 1]);
+            } else {
+                node.kind = flat_node::n_char;
+                node.c    = static_cast<char>(b);
+            }
+            return i + 1;
+        }
+
+        node.kind = flat_node::n_char;
+        node.c    = c;
+        return i;
+    }
+
+    // the alter and the current concat of every open group, the top level
+    // is level 0
+    struct level {
+        int alter  = -1;
+        int concat = -1;
+    };
+
+    static constexpr flat_AST<capacity> parse() {
+        flat_AST<capacity>     res;
+        array<level, capacity> levels;
+        int                    depth = 0;
+
+        // the atom a modifier applies to, -1 if there is none
+        int atom = -1;
+
+        levels[0].alter  = res.add(flat_node::n_alter);
+        levels[0].concat = res.add(flat_node::n_concat);
+        res.append_child(levels[0].alter, levels[0].concat);
+
+        for (int i = 0; i < fstr.size() && res.correct; i++) {
+            char   c   = fstr[i];
+            level& cur = levels[depth];
+
+            if (c == '*' || c == '+' || c == '?' || c == '{') {
+                if (atom < 0) {
+                    res.correct = false;
+                    break;
+                }
+
+                flat_node mod;
+                mod.kind = c == '*'   ? flat_node::n_star
+                           : c == '+' ? flat_node::n_plus
+                           : c == '?' ? flat_node::n_opt
+                                      : flat_node::n_repeat;
+                if (c == '{') {
+                    i = read_repeat(i + 1, mod);
+                    if (i < 0) {
+                        res.correct = false;
+                        break;
+                    }
+                }
+
+                // The wrapper takes the atom's index so the sibling links
+                // stay valid, the atom moves to a fresh node.
+                int moved       = res.size++;
+                int next        = res[atom].next;
+                res[moved]      = res[atom];
+                res[moved].next = -1;
+
+                res[atom]       = mod;
+                res[atom].first = moved;
+                res[atom].last  = moved;
+                res[atom].next  = next;
+                atom            = -1;
+            } else if (c == '|') {
+                // neither side of | may be empty
+                if (res[cur.concat].first < 0) {
+                    res.correct = false;
+                    break;
+                }
+                cur.concat = res.add(flat_node::n_concat);
+                res.append_child(cur.alter, cur.concat);
+                atom = -1;
+            } else if (c == '(') {
+                int group        = res.add(flat_node::n_capture);
+                res[group].group = res.group_count++;
+                res.append_child(cur.concat, group);
+
+                depth++;
+                levels[depth].alter  = res.add(flat_node::n_alter);
+                levels[depth].concat = res.add(flat_node::n_concat);
+                res.append_child(group, levels[depth].alter);
+                res.append_child(levels[depth].alter, levels[depth].concat);
+                atom = -1;
+            } else if (c == ')') {
+                if (depth == 0 || res[cur.concat].first < 0) {
+                    res.correct = false;
+                    break;
+                }
+                depth--;
+                // the capture is the last child of the enclosing concat
+                atom = res[levels[depth].concat].last;
+            } else {
+                flat_node node;
+                int       end = read_atom(i, node);
+                if (end < 0) {
+                    res.correct = false;
+                    break;
+                }
+                atom          = res.add(node.kind, node.c);
+                res[atom].set = node.set;
+                res.append_child(cur.concat, atom);
+                i = end;
+            }
+        }
+
+        // the last alternative may only be empty if it is the whole pattern
+        const flat_node& root = res[levels[0].alter];
+        if (depth != 0 || (res[root.last].first < 0 && root.first != root.last))
+            res.correct = false;
+        return res;
+    }
+
+  public:
+    static constexpr flat_AST<capacity> res = parse();
+
+    static constexpr bool correct = res.correct;
+};
+
+#endif
@@ -0,0 +1,391 @@
+#ifndef CTRE_GLUSHKOV_H
+#define CTRE_GLUSHKOV_H
+
+#include "array.h"
+#include "flat_parser.h"
+#include "parse_table.h"  // for AST types
+#include <cstdint>
+
+// Glushkov automaton: one state per character position in the pattern, no
+// epsilon transitions. Positions are numbered from left to right and stored
+// as bits of a uint64_t, so patterns with up to 64 positions are matched
+// with a few shifts, ANDs and ORs per input byte.
+//
+// Most follow edges go from position p to p + 1, those are covered by a
+// single shift. The remaining ones (loops, alternation joins) are looked up
+// per active position in `extra`.
+struct glushkov_automata {
+    // positions labeled with each byte
+    array<uint64_t, 256> masks;
+    // follow(p) minus the p + 1 edge covered by the shift
+    array<uint64_t, 64> extra;
+
+    uint64_t first          = 0;
+    uint64_t last           = 0;
+    uint64_t shift_mask     = 0;  // positions p + 1 that follow p
+    uint64_t exception_mask = 0;  // positions with non-empty extra
+    uint64_t accepting      = 0;  // last positions that accept whatever follows
+    bool     nullable       = false;
+
+    // active positions after reading c, d is the set before it
+    constexpr uint64_t step(uint64_t d, unsigned char c) const {
+        uint64_t next = (d << 1) & shift_mask;
+        for (uint64_t x = d & exception_mask; x; x &= x - 1) {
+            next |= extra[__builtin_ctzll(x)];
+        }
+        return next & masks[c];
+    }
+};
+
+// first, last and nullable of a sub-expression
+struct glushkov_info {
+    uint64_t first    = 0;
+    uint64_t last     = 0;
+    bool     nullable = true;
+};
+
+//
+// Position count
+//
+
+constexpr int position_count(epsilon) {
+    return 0;
+}
+
+template <char C>
+constexpr int position_count(ch<C>) {
+    return 1;
+}
+
+template <bool NEGATED, typename... Items>
+constexpr int position_count(char_class<NEGATED, Items...>) {
+    return 1;
+}
+
+template <typename... Ts>
+constexpr int position_count(concat<Ts...>) {
+    return (position_count(Ts{}) + ...);
+}
+
+template <typename... Ts>
+constexpr int position_count(alter<Ts...>) {
+    return (position_count(Ts{}) + ...);
+}
+
+template <typename T>
+constexpr int position_count(star<T>) {
+    return position_count(T{});
+}
+
+// x{MIN,} is x{MIN} x*
+template <int MIN, int MAX, typename T>
+constexpr int position_count(repeat<MIN, MAX, T>) {
+    return position_count(T{}) * (MAX < 0 ? MIN + 1 : MAX);
+}
+
+//
+// Position analysis, fills g.masks with the label of each position and
+// `follow` with the follow sets. `pos` is the next free position.
+//
+
+constexpr glushkov_info glushkov_analyze(epsilon, glushkov_automata&, array<uint64_t, 64>&, int&) {
+    return {};
+}
+
+template <char C>
+constexpr glushkov_info glushkov_analyze(ch<C>, glushkov_automata& g, array<uint64_t, 64>&, int& pos) {
+    uint64_t bit = uint64_t(1) << pos;
+    pos++;
+
+    g.masks[static_cast<unsigned char>(C)] |= bit;
+    return { bit, bit, false };
+}
+
+// a position labeled with every byte of set
+constexpr glushkov_info glushkov_position(const byte_set& set, glushkov_automata& g, int& pos) {
+    uint64_t bit = uint64_t(1) << pos;
+    pos++;
+
+    for (int c = 0; c < 256; c++) {
+        if (set.test(c))
+            g.masks[c] |= bit;
+    }
+    return { bit, bit, false };
+}
+
+template <bool NEGATED, typename... Items>
+constexpr glushkov_info glushkov_analyze(char_class<NEGATED, Items...>, glushkov_automata& g, array<uint64_t, 64>&, int& pos) {
+    return glushkov_position(class_set<char_class<NEGATED, Items...>>::res, g, pos);
+}
+
+constexpr void glushkov_link(array<uint64_t, 64>& follow, uint64_t from, uint64_t to) {
+    for (int p = 0; p < 64; p++) {
+        if ((from >> p) & 1)
+            follow[p] |= to;
+    }
+}
+
+// res followed by rhs
+constexpr void glushkov_concat(glushkov_info& res, const glushkov_info& rhs, array<uint64_t, 64>& follow) {
+    glushkov_link(follow, res.last, rhs.first);
+    res.first    = res.nullable ? res.first | rhs.first : res.first;
+    res.last     = rhs.nullable ? res.last | rhs.last : rhs.last;
+    res.nullable = res.nullable && rhs.nullable;
+}
+
+// res or branch
+constexpr void glushkov_alter(glushkov_info& res, const glushkov_info& branch) {
+    res.first |= branch.first;
+    res.last |= branch.last;
+    res.nullable = res.nullable || branch.nullable;
+}
+
+constexpr glushkov_info glushkov_star(glushkov_info res, array<uint64_t, 64>& follow) {
+    glushkov_link(follow, res.last, res.first);
+    res.nullable = true;
+    return res;
+}
+
+// x{min,max} out of its copies, each with positions of its own. The copies
+// from min on are nested options, x(x(x)?)?, so a copy only follows the
+// one before it. For {min,} the copy after the min mandatory ones loops.
+constexpr glushkov_info glushkov_repeat(array<glushkov_info, 64>& copies, int min, int max, array<uint64_t, 64>& follow) {
+    if (max < 0) {
+        copies[min] = glushkov_star(copies[min], follow);
+        min = max = min + 1;
+    }
+
+    glushkov_info tail;
+    for (int i = max - 1; i >= min; i--) {
+        glushkov_info copy = copies[i];
+        glushkov_concat(copy, tail, follow);
+        copy.nullable = true;
+        tail          = copy;
+    }
+
+    glushkov_info res;
+    for (int i = 0; i < min; i++) {
+        glushkov_concat(res, copies[i], follow);
+    }
+    glushkov_concat(res, tail, follow);
+    return res;
+}
+
+template <typename... Ts>
+constexpr glushkov_info glushkov_analyze(concat<Ts...>, glushkov_automata& g, array<uint64_t, 64>& follow, int& pos) {
+    glushkov_info res;
+
+    // evaluated left to right, which numbers positions left to right
+    (glushkov_concat(res, glushkov_analyze(Ts{}, g, follow, pos), follow), ...);
+
+    return res;
+}
+
+template <typename... Ts>
+constexpr glushkov_info glushkov_analyze(alter<Ts...>, glushkov_automata& g, array<uint64_t, 64>& follow, int& pos) {
+    glushkov_info res;
+    res.nullable = false;
+
+    (glushkov_alter(res, glushkov_analyze(Ts{}, g, follow, pos)), ...);
+
+    return res;
+}
+
+template <typename T>
+constexpr glushkov_info glushkov_analyze(star<T>, glushkov_automata& g, array<uint64_t, 64>& follow, int& pos) {
+    return glushkov_star(glushkov_analyze(T{}, g, follow, pos), follow);
+}
+
+// only analyzed when it fits, so there are at most 64 copies
+template <int MIN, int MAX, typename T>
+constexpr glushkov_info glushkov_analyze(repeat<MIN, MAX, T>, glushkov_automata& g, array<uint64_t, 64>& follow, int& pos) {
+    array<glushkov_info, 64> copies;
+    for (int i = 0; i < (MAX < 0 ? MIN + 1 : MAX); i++) {
+        copies[i] = glushkov_analyze(T{}, g, follow, pos);
+    }
+    return glushkov_repeat(copies, MIN, MAX, follow);
+}
+
+//
+// Position count and analysis over a flat AST
+//
+
+template <int N>
+constexpr int position_count(const flat_AST<N>& ast, int node) {
+    const flat_node& n = ast[node];
+
+    switch (n.kind) {
+    case flat_node::n_char:
+    case flat_node::n_class:
+        return 1;
+    case flat_node::n_concat:
+    case flat_node::n_alter: {
+        int res = 0;
+        for (int child = n.first; child >= 0; child = ast[child].next) {
+            res += position_count(ast, child);
+        }
+        return res;
+    }
+    case flat_node::n_plus:
+        // concat<T, star<T>>
+        return 2 * position_count(ast, n.first);
+    case flat_node::n_star:
+    case flat_node::n_opt:
+    case flat_node::n_capture:
+        return position_count(ast, n.first);
+    case flat_node::n_repeat:
+        return position_count(ast, n.first) * (n.max < 0 ? n.min + 1 : n.max);
+    default:
+        return 0;
+    }
+}
+
+template <int N>
+constexpr glushkov_info glushkov_analyze(const flat_AST<N>& ast, int node, glushkov_automata& g, array<uint64_t, 64>& follow, int& pos) {
+    const flat_node& n = ast[node];
+    glushkov_info    res;
+
+    switch (n.kind) {
+    case flat_node::n_char: {
+        uint64_t bit = uint64_t(1) << pos;
+        pos++;
+
+        g.masks[static_cast<unsigned char>(n.c)] |= bit;
+        return { bit, bit, false };
+    }
+    case flat_node::n_class:
+        return glushkov_position(n.set, g, pos);
+    case flat_node::n_concat:
+        for (int child = n.first; child >= 0; child = ast[child].next) {
+            glushkov_concat(res, glushkov_analyze(ast, child, g, follow, pos), follow);
+        }
+        return res;
+    case flat_node::n_alter:
+        res.nullable = false;
+        for (int child = n.first; child >= 0; child = ast[child].next) {
+            glushkov_alter(res, glushkov_analyze(ast, child, g, follow, pos));
+        }
+        return res;
+    case flat_node::n_star:
+        return glushkov_star(glushkov_analyze(ast, n.first, g, follow, pos), follow);
+    case flat_node::n_plus:
+        // concat<T, star<T>>, the second copy gets positions of its own
+        res = glushkov_analyze(ast, n.first, g, follow, pos);
+        glushkov_concat(res, glushkov_star(glushkov_analyze(ast, n.first, g, follow, pos), follow), follow);
+        return res;
+    case flat_node::n_opt:
+        // alter<T, epsilon>
+        glushkov_alter(res, glushkov_analyze(ast, n.first, g, follow, pos));
+        return res;
+    case flat_node::n_repeat: {
+        array<glushkov_info, 64> copies;
+        for (int i = 0; i < (n.max < 0 ? n.min + 1 : n.max); i++) {
+            copies[i] = glushkov_analyze(ast, n.first, g, follow, pos);
+        }
+        return glushkov_repeat(copies, n.min, n.max, follow);
+    }
+    case flat_node::n_capture:
+        return glushkov_analyze(ast, n.first, g, follow, pos);
+    default:
+        return res;
+    }
+}
+
+//
+// Builder
+//
+
+// Turns the follow sets into the shift and exception masks. Positions that
+// can't reach a last one are taken out of the masks, so no input reaches
+// them and the active set turns empty once nothing can match. Accepting
+// positions are last and followed by accepting positions on every byte.
+constexpr void glushkov_finish(glushkov_automata& res, const glushkov_info& info, array<uint64_t, 64> follow) {
+    uint64_t live = info.last;
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (int p = 0; p < 64; p++) {
+            uint64_t bit = uint64_t(1) << p;
+            if (!(live & bit) && (follow[p] & live)) {
+                live |= bit;
+                changed = true;
+            }
+        }
+    }
+    for (int c = 0; c < 256; c++) {
+        res.masks[c] &= live;
+    }
+    for (int p = 0; p < 64; p++) {
+        follow[p] &= live;
+    }
+
+    res.first    = info.first & live;
+    res.last     = info.last;
+    res.nullable = info.nullable;
+
+    res.accepting = info.last;
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (uint64_t x = res.accepting; x; x &= x - 1) {
+            int p = __builtin_ctzll(x);
+            for (int c = 0; c < 256; c++) {
+                if (!(follow[p] & res.accepting & res.masks[c])) {
+                    res.accepting &= ~(uint64_t(1) << p);
+                    changed = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    for (int p = 0; p < 64; p++) {
+        uint64_t next = p < 63 ? uint64_t(1) << (p + 1) : 0;
+
+        if (follow[p] & next)
+            res.shift_mask |= next;
+
+        res.extra[p] = follow[p] & ~next;
+        if (res.extra[p])
+            res.exception_mask |= uint64_t(1) << p;
+    }
+}
+
+template <typename AST>
+struct glushkov {
+    static constexpr int position_count = ::position_count(AST{});
+
+    static constexpr bool fits = position_count <= 64;
+
+    static constexpr glushkov_automata build() {
+        glushkov_automata   res;
+        array<uint64_t, 64> follow;
+        int                 pos = 0;
+
+        if constexpr (fits)
+            glushkov_finish(res, glushkov_analyze(AST{}, res, follow, pos), follow);
+        return res;
+    }
+
+    static constexpr glushkov_automata res = build();
+};
+
+// glushkov over a flat AST
+template <auto& AST>
+struct flat_glushkov {
+    static constexpr int position_count = ::position_count(AST, 0);
+
+    static constexpr bool fits = position_count <= 64;
+
+    static constexpr glushkov_automata build() {
+        glushkov_automata   res;
+        array<uint64_t, 64> follow;
+        int                 pos = 0;
+
+        if constexpr (fits)
+            glushkov_finish(res, glushkov_analyze(AST, 0, res, follow, pos), follow);
+        return res;
+    }
+
+    static constexpr glushkov_automata res = build();
+};
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef CTRE_INSTRUMENT_H
+#define CTRE_INSTRUMENT_H
+
+#include <cstddef>
+
+// Instrumentation policies, passed as the third template argument of match
+// and search. Engines report what they do through the policy's static
+// functions. no_instrumentation's are empty, so the default costs nothing.
+
+struct instrument_counts {
+    size_t bytes_scanned    = 0;  // by the engines and search's skip loops
+    size_t states_visited   = 0;  // DFA states, NFA threads or Glushkov positions, per byte
+    size_t backtrack_pushes = 0;  // backtrack_engine only
+    size_t prefilter_hits   = 0;  // inputs the literal prefilter decided alone
+};
+
+struct no_instrumentation {
+    static constexpr bool enabled = false;
+
+    static void bytes(size_t) {}
+    static void states(size_t) {}
+    static void push() {}
+    static void prefilter_hit() {}
+};
+
+// Counts into a thread_local instrument_counts. Give each pattern its own
+// Tag to keep their counts apart.
+template <typename Tag = void>
+struct count_instrumentation {
+    static constexpr bool enabled = true;
+
+    static inline thread_local instrument_counts counts;
+
+    static void bytes(size_t n) {
+        counts.bytes_scanned += n;
+    }
+
+    static void states(size_t n) {
+        counts.states_visited += n;
+    }
+
+    static void push() {
+        counts.backtrack_pushes++;
+    }
+
+    static void prefilter_hit() {
+        counts.prefilter_hits++;
+    }
+
+    static void reset() {
+        counts = {};
+    }
+};
+
+#endif
@@ -0,0 +1,201 @@
+#ifndef CTRE_LAZY_DFA_H
+#define CTRE_LAZY_DFA_H
+
+#include "bitset.h"
+#include "compact.h"
+#include "instrument.h"
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+
+//
+// Lazy DFA
+//
+
+// Subset construction at run time, one DFA state at a time and only for
+// the states the input reaches. Patterns like (a|b)*a(a|b)(a|b)... have
+// more DFA states than FA_determinize may build, but an input only walks
+// through a few of them. The states live in a per-thread cache of
+// lazy_dfa_cache_states entries. When it is full it is flushed and
+// refilled; when it fills up again within a few bytes per cached state the
+// input is finished by simulating the NFA instead.
+
+static constexpr int lazy_dfa_cache_states = 128;
+
+// bytes per cached state that must pass between two flushes
+static constexpr int lazy_dfa_min_bytes_per_state = 8;
+
+// NFA is in the layout of compact.h
+template <auto& NFA>
+struct lazy_dfa {
+    static constexpr int N_S      = NFA.state_count();
+    static constexpr int CAPACITY = lazy_dfa_cache_states;
+
+    using state_set = bitset<N_S>;
+
+    // cached states have a column per byte class, see FA_determinize
+    static constexpr byte_classes classes = make_byte_classes(NFA.edges);
+    static constexpr int          STRIDE  = classes.stride();
+
+    static constexpr uint8_t unknown     = 255;
+    static constexpr int     dead_state  = 0;
+    static constexpr int     start_state = 1;
+
+    static_assert(CAPACITY < unknown, "lazy DFA state ids are bytes");
+
+    struct cache {
+        // next[s * STRIDE + k] is unknown until s has been stepped over a
+        // byte of class k
+        uint8_t   next[CAPACITY * STRIDE];
+        state_set sets[CAPACITY];
+        uint64_t  hashes[CAPACITY];
+        bool      decided[CAPACITY];  // the empty set, or one with an accepting state
+        int       size = 0;
+
+        // open addressing from set hashes to states, at most half full
+        int table[2 * CAPACITY];
+
+        size_t bytes_since_flush = 0;
+
+        void flush() {
+            std::memset(next, unknown, sizeof(next));
+            for (int& slot : table) {
+                slot = -1;
+            }
+            size              = 0;
+            bytes_since_flush = 0;
+
+            add(state_set{});
+            state_set start;
+            start.set(0);
+            add(start);
+        }
+
+        // the state of set, -1 if it isn't cached
+        int find(const state_set& set, uint64_t h) const {
+            for (int slot = h % (2 * CAPACITY); table[slot] >= 0; slot = (slot + 1) % (2 * CAPACITY)) {
+                if (hashes[table[slot]] == h && sets[table[slot]] == set)
+                    return table[slot];
+            }
+            return -1;
+        }
+
+        int add(const state_set& set) {
+            uint64_t h    = set.hash();
+            int      slot = h % (2 * CAPACITY);
+            while (table[slot] >= 0) {
+                slot = (slot + 1) % (2 * CAPACITY);
+            }
+
+            int s       = size++;
+            table[slot] = s;
+            sets[s]     = set;
+            hashes[s]   = h;
+            decided[s]  = !set.any() || set.intersects(NFA.accepting_states);
+            return s;
+        }
+    };
+
+    static cache& local_cache() {
+        static thread_local cache c;
+        if (c.size == 0)
+            c.flush();
+        return c;
+    }
+
+    // NFA states reached from `from` over c
+    static state_set step(const state_set& from, unsigned char c) {
+        state_set res;
+        for (int w = 0; w < state_set::n_words; w++) {
+            for (uint64_t x = from.words[w]; x; x &= x - 1) {
+                int state = w * 64 + __builtin_ctzll(x);
+                for (int e = NFA.begin(state); e < NFA.end(state); e++) {
+                    if (NFA.edges[e].match(c))
+                        res.set(NFA.edges[e].dst);
+                }
+            }
+        }
+        return res;
+    }
+
+    static int count(const state_set& set) {
+        int res = 0;
+        for (uint64_t w : set.words) {
+            res += __builtin_popcountll(w);
+        }
+        return res;
+    }
+
+    // NFA simulation over the rest of the input, starting from set. The
+    // bytes count towards the next flush, or a cache that thrashed once
+    // would never be used again.
+    template <bool DECIDE, typename It, typename Instrument>
+    static state_set simulate(cache& c, state_set set, It first, It last, Instrument) {
+        for (; first != last; ++first) {
+            c.bytes_since_flush++;
+            Instrument::bytes(1);
+            if constexpr (Instrument::enabled)
+                Instrument::states(count(set));
+            set = step(set, static_cast<unsigned char>(*first));
+            if (!set.any() || (DECIDE && set.intersects(NFA.accepting_states)))
+                break;
+        }
+        return set;
+    }
+};
+
+// The set of NFA states [first, last) leads to. It is exact when DECIDE is
+// false, the run only stops early at the empty set. With DECIDE it also
+// stops at a set with an accepting state, which only tells whether the
+// input matches.
+template <auto& NFA, bool DECIDE, typename It, typename Instrument = no_instrumentation>
+typename lazy_dfa<NFA>::state_set run_lazy_dfa_states(It first, It last, Instrument = {}) {
+    using L = lazy_dfa<NFA>;
+
+    typename L::cache& c     = L::local_cache();
+    int                state = L::start_state;
+
+    for (; first != last; ++first) {
+        unsigned char b    = static_cast<unsigned char>(*first);
+        int           k    = L::classes.of[b];
+        int           next = c.next[state * L::STRIDE + k];
+        Instrument::bytes(1);
+        Instrument::states(1);
+        c.bytes_since_flush++;
+
+        if (next == L::unknown) {
+            typename L::state_set set = L::step(c.sets[state], b);
+            uint64_t              h   = set.hash();
+            next                      = c.find(set, h);
+            if (next < 0) {
+                if (c.size == L::CAPACITY) {
+                    // thrashing, the cache doesn't pay for itself
+                    if (c.bytes_since_flush < size_t(lazy_dfa_min_bytes_per_state) * L::CAPACITY)
+                        return L::template simulate<DECIDE>(c, set, std::next(first), last, Instrument{});
+
+                    // the flush drops state, the edge to set isn't recorded
+                    c.flush();
+                    next  = c.find(set, h);
+                    state = next >= 0 ? next : c.add(set);
+                    if (DECIDE ? c.decided[state] : state == L::dead_state)
+                        break;
+                    continue;
+                }
+                next = c.add(set);
+            }
+            c.next[state * L::STRIDE + k] = next;
+        }
+
+        state = next;
+        if (DECIDE ? c.decided[state] : state == L::dead_state)
+            break;
+    }
+    return c.sets[state];
+}
+
+template <auto& NFA, typename It, typename Instrument = no_instrumentation>
+bool run_lazy_dfa(It first, It last, Instrument = {}) {
+    return run_lazy_dfa_states<NFA, true>(first, last, Instrument{}).intersects(NFA.final_states);
+}
+
+#endif
@@ -0,0 +1,327 @@
+#ifndef CTRE_LITERAL_H
+#define CTRE_LITERAL_H
+
+#include "flat_parser.h"
+#include "parse_table.h"  // for AST types
+#include <cstddef>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Short string that every match of a (sub-)pattern is known to contain.
+// Longer literals are cut down to a substring that still has to occur.
+struct literal {
+    static constexpr int capacity = 32;
+
+    char data[capacity] = {};
+    int  size           = 0;
+
+    constexpr char operator[](int idx) const {
+        return data[idx];
+    }
+
+    constexpr bool operator==(const literal& other) const {
+        if (size != other.size)
+            return false;
+        for (int i = 0; i < size; i++) {
+            if (data[i] != other.data[i])
+                return false;
+        }
+        return true;
+    }
+};
+
+// keeps the first `capacity` characters of lhs + rhs
+constexpr literal append_head(const literal& lhs, const literal& rhs) {
+    literal res = lhs;
+    for (int i = 0; i < rhs.size && res.size < literal::capacity; i++) {
+        res.data[res.size++] = rhs[i];
+    }
+    return res;
+}
+
+// keeps the last `capacity` characters of lhs + rhs
+constexpr literal append_tail(const literal& lhs, const literal& rhs) {
+    int     total = lhs.size + rhs.size;
+    int     skip  = total > literal::capacity ? total - literal::capacity : 0;
+    literal res;
+    for (int i = skip; i < total; i++) {
+        res.data[res.size++] = i < lhs.size ? lhs[i] : rhs[i - lhs.size];
+    }
+    return res;
+}
+
+constexpr literal common_prefix(const literal& lhs, const literal& rhs) {
+    literal res;
+    while (res.size < lhs.size && res.size < rhs.size && lhs[res.size] == rhs[res.size]) {
+        res.data[res.size] = lhs[res.size];
+        res.size++;
+    }
+    return res;
+}
+
+constexpr literal common_suffix(const literal& lhs, const literal& rhs) {
+    int n = 0;
+    while (n < lhs.size && n < rhs.size && lhs[lhs.size - 1 - n] == rhs[rhs.size - 1 - n]) {
+        n++;
+    }
+    literal res;
+    for (int i = lhs.size - n; i < lhs.size; i++) {
+        res.data[res.size++] = lhs[i];
+    }
+    return res;
+}
+
+constexpr const literal& longer(const literal& lhs, const literal& rhs) {
+    return rhs.size > lhs.size ? rhs : lhs;
+}
+
+// What the strings matched by a sub-pattern have in common.
+// If exact is set, the sub-pattern only matches prefix (== suffix == factor).
+struct literal_info {
+    literal prefix;
+    literal suffix;
+    literal factor;  // required somewhere in every match
+    bool    exact = true;
+};
+
+//
+// Literal analysis over AST types
+//
+
+constexpr literal_info literal_analyze(epsilon) {
+    return {};
+}
+
+template <char C>
+constexpr literal_info literal_analyze(ch<C>) {
+    literal_info res;
+    res.prefix.data[0] = C;
+    res.prefix.size    = 1;
+    res.suffix         = res.prefix;
+    res.factor         = res.prefix;
+    return res;
+}
+
+// A class of one byte is that byte, other classes only tell how long the
+// match is, which isn't tracked.
+constexpr literal_info literal_class(const byte_set& set) {
+    literal_info res;
+    int          b = single_byte(set);
+    if (b < 0) {
+        res.exact = false;
+        return res;
+    }
+    res.prefix.data[0] = static_cast<char>(b);
+    res.prefix.size    = 1;
+    res.suffix         = res.prefix;
+    res.factor         = res.prefix;
+    return res;
+}
+
+template <bool NEGATED, typename... Items>
+constexpr literal_info literal_analyze(char_class<NEGATED, Items...>) {
+    return literal_class(class_set<char_class<NEGATED, Items...>>::res);
+}
+
+constexpr literal_info literal_concat(const literal_info& lhs, const literal_info& rhs) {
+    literal_info res;
+
+    res.exact = lhs.exact && rhs.exact && lhs.prefix.size + rhs.prefix.size <= literal::capacity;
+
+    res.prefix = lhs.exact ? append_head(lhs.prefix, rhs.prefix) : lhs.prefix;
+    res.suffix = rhs.exact ? append_tail(lhs.suffix, rhs.suffix) : rhs.suffix;
+
+    // lhs's suffix is always directly followed by rhs's prefix
+    literal joint = append_head(lhs.suffix, rhs.prefix);
+    res.factor    = longer(longer(lhs.factor, rhs.factor), longer(joint, longer(res.prefix, res.suffix)));
+    return res;
+}
+
+template <typename... Ts>
+constexpr literal_info literal_analyze(concat<Ts...>) {
+    literal_info res;
+    ((res = literal_concat(res, literal_analyze(Ts{}))), ...);
+    return res;
+}
+
+constexpr literal_info literal_alter(const literal_info& lhs, const literal_info& rhs) {
+    literal_info res;
+
+    res.exact  = lhs.exact && rhs.exact && lhs.prefix == rhs.prefix;
+    res.prefix = common_prefix(lhs.prefix, rhs.prefix);
+    res.suffix = common_suffix(lhs.suffix, rhs.suffix);
+    res.factor = res.exact ? lhs.factor : longer(res.prefix, res.suffix);
+    return res;
+}
+
+template <typename T, typename... Ts>
+constexpr literal_info literal_analyze(alter<T, Ts...>) {
+    literal_info res = literal_analyze(T{});
+    ((res = literal_alter(res, literal_analyze(Ts{}))), ...);
+    return res;
+}
+
+// may match the empty string, so nothing is required
+template <typename T>
+constexpr literal_info literal_analyze(star<T>) {
+    literal_info res;
+    res.exact = false;
+    return res;
+}
+
+// x{min,max} is x^min followed by something optional. Past capacity + 1
+// copies the literals no longer change, so the loop stops there.
+constexpr literal_info literal_repeat(const literal_info& x, int min, int max) {
+    literal_info res;
+    for (int i = 0; i < min && i <= literal::capacity; i++) {
+        res = literal_concat(res, x);
+    }
+
+    if (max != min) {
+        literal_info rest;
+        rest.exact = false;
+        res        = literal_concat(res, rest);
+    }
+    return res;
+}
+
+template <int MIN, int MAX, typename T>
+constexpr literal_info literal_analyze(repeat<MIN, MAX, T>) {
+    return literal_repeat(literal_analyze(T{}), MIN, MAX);
+}
+
+template <typename AST>
+struct literal_analysis {
+    static constexpr literal_info res = literal_analyze(AST{});
+};
+
+//
+// Literal analysis over a flat AST
+//
+
+template <int N>
+constexpr literal_info literal_analyze(const flat_AST<N>& ast, int node) {
+    const flat_node& n = ast[node];
+    literal_info     res;
+
+    switch (n.kind) {
+    case flat_node::n_char: {
+        res.prefix.data[0] = n.c;
+        res.prefix.size    = 1;
+        res.suffix         = res.prefix;
+        res.factor         = res.prefix;
+        break;
+    }
+    case flat_node::n_class:
+        res = literal_class(n.set);
+        break;
+    case flat_node::n_concat:
+        for (int child = n.first; child >= 0; child = ast[child].next) {
+            res = literal_concat(res, literal_analyze(ast, child));
+        }
+        break;
+    case flat_node::n_alter:
+        res = literal_analyze(ast, n.first);
+        for (int child = ast[n.first].next; child >= 0; child = ast[child].next) {
+            res = literal_alter(res, literal_analyze(ast, child));
+        }
+        break;
+    case flat_node::n_star:
+        res.exact = false;
+        break;
+    case flat_node::n_plus: {
+        // concat<T, star<T>>
+        literal_info loop;
+        loop.exact = false;
+        res        = literal_concat(literal_analyze(ast, n.first), loop);
+        break;
+    }
+    case flat_node::n_opt:
+        // alter<T, epsilon>
+        res = literal_alter(res, literal_analyze(ast, n.first));
+        break;
+    case flat_node::n_repeat:
+        res = literal_repeat(literal_analyze(ast, n.first), n.min, n.max);
+        break;
+    case flat_node::n_capture:
+        res = literal_analyze(ast, n.first);
+        break;
+    default:
+        break;
+    }
+    return res;
+}
+
+template <auto& AST>
+struct flat_literal_analysis {
+    static constexpr literal_info res = literal_analyze(AST, 0);
+};
+
+//
+// Prefilter
+//
+
+// position of the first occurrence of lit in [idx, size), or size.
+// Candidates are positions where both the first and the last byte of lit
+// match, they are compared 16 at a time and verified with memcmp.
+inline size_t find_literal(const literal& lit, const char* data, size_t idx, size_t size) {
+    size_t n = lit.size;
+    if (n == 0)
+        return idx;
+    if (size < n || idx > size - n)
+        return size;
+
+    size_t last = size - n;  // last possible starting position
+
+#ifdef __SSE2__
+    const __m128i first_byte = _mm_set1_epi8(lit[0]);
+    const __m128i last_byte  = _mm_set1_epi8(lit[n - 1]);
+    for (; idx + 16 <= last + 1; idx += 16) {
+        __m128i head = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + idx));
+        __m128i tail = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + idx + n - 1));
+        int     mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(head, first_byte), _mm_cmpeq_epi8(tail, last_byte)));
+        while (mask) {
+            size_t pos = idx + __builtin_ctz(mask);
+            if (std::memcmp(data + pos + 1, lit.data + 1, n - 1) == 0)
+                return pos;
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    while (idx <= last) {
+        const void* found = std::memchr(data + idx, lit[0], last - idx + 1);
+        if (!found)
+            return size;
+
+        size_t pos = static_cast<const char*>(found) - data;
+        if (std::memcmp(data + pos + 1, lit.data + 1, n - 1) == 0)
+            return pos;
+        idx = pos + 1;
+    }
+    return size;
+}
+
+// false if the input can't match a pattern with literal info `info` anchored on both ends
+inline bool prefilter_match(const literal_info& info, const char* data, size_t size) {
+    if (info.exact)
+        return size == static_cast<size_t>(info.prefix.size) && std::memcmp(data, info.prefix.data, size) == 0;
+
+    size_t n_prefix = info.prefix.size, n_suffix = info.suffix.size;
+    if (size < n_prefix || size < n_suffix)
+        return false;
+    if (std::memcmp(data, info.prefix.data, n_prefix) != 0)
+        return false;
+    if (std::memcmp(data + size - n_suffix, info.suffix.data, n_suffix) != 0)
+        return false;
+
+    // the factor is only worth scanning for if it says more than prefix and suffix
+    if (info.factor.size > info.prefix.size && info.factor.size > info.suffix.size)
+        return find_literal(info.factor, data, 0, size) != size;
+    return true;
+}
+
+#endif
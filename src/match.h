@@ -1,51 +1,380 @@
 #ifndef CTRE_MATCH_H
 #define CTRE_MATCH_H
 
+#include "codegen.h"
+#include "compact.h"
 #include "finite_automata.h"
+#include "flat_parser.h"
+#include "glushkov.h"
+#include "instrument.h"
+#include "lazy_dfa.h"
+#include "literal.h"
 #include "parser.h"
+#include <iterator>
 #include <stack>
 #include <string>
+#include <string_view>
+#include <type_traits>
 
-template <auto& pattern>
-bool match(const std::string& target_str) {
-    constexpr auto ast = typename parser<pattern, parse_table>::AST{};
-    static_assert(parser<pattern, parse_table>::correct, "Regular expression syntax error");
+//
+// Engines
+//
+
+// Pass one of these as the second template argument of match to pick how
+// the pattern is run. auto_engine uses the bit-parallel engine when the
+// pattern has at most 64 character positions, the DFA when the pattern
+// determinizes within FA_determinize's state budget and falls back to the
+// lazy DFA otherwise. codegen_engine runs the same DFA compiled into code,
+// it is never picked automatically since its code grows with the DFA.
+struct auto_engine {
+    static constexpr const char* name = "auto";
+};
+struct bit_parallel_engine {
+    static constexpr const char* name = "bit_parallel";
+};
+struct dfa_engine {
+    static constexpr const char* name = "dfa";
+};
+struct codegen_engine {
+    static constexpr const char* name = "codegen";
+};
+struct lazy_dfa_engine {
+    static constexpr const char* name = "lazy_dfa";
+};
+struct pike_vm_engine {
+    static constexpr const char* name = "pike_vm";
+};
+struct backtrack_engine {
+    static constexpr const char* name = "backtrack";
+};
 
-    constexpr auto nfa = build_FA(ast);
-    // nfa.print();
+// Engines take the input as a pair of forward iterators over bytes and
+// never read outside [first, last). They report to the instrumentation
+// policy passed last, see instrument.h. They stop reading as soon as no
+// input that follows can change the answer: when no state that can still
+// reach a final one is left, or when one that accepts everything is reached.
 
-    // state number, index in target str
-    std::stack<std::pair<int, int>> st;
-    st.push(std::make_pair(0, 0));
+// depth first walk over the NFA
+template <int N_S, int N_T, typename It, typename Instrument = no_instrumentation>
+bool run(backtrack_engine, const compact_automata<N_S, N_T>& nfa, It first, It last, Instrument = {}) {
+    // state number, position in input
+    std::stack<std::pair<int, It>> st;
+    st.push(std::make_pair(0, first));
+    Instrument::push();
     while (!st.empty()) {
-        auto [state, idx] = st.top();
+        auto [state, it] = st.top();
         st.pop();
+        Instrument::states(1);
 
-        // target_str[0, idx) is matched
-        if (idx == target_str.size()) {
-            if (nfa.is_final_state(state)) {
+        if (nfa.is_accepting_state(state))
+            return true;
+
+        // [first, it) is matched
+        if (it == last) {
+            if (nfa.is_final_state(state))
                 return true;
+            continue;
+        }
+
+        Instrument::bytes(1);
+        for (int i = nfa.begin(state); i < nfa.end(state); i++) {
+            if (nfa.edges[i].match(static_cast<unsigned char>(*it))) {
+                st.push(std::make_pair(nfa.edges[i].dst, std::next(it)));
+                Instrument::push();
             }
         }
+    }
 
-        int idx_trans = nfa.lower_idx_in_trans(state);
-        if (idx_trans < 0)
-            continue;
+    return false;
+}
+
+// The set of active NFA states, kept both as a bitset for membership tests
+// and as a list for iteration. Everything lives on the stack.
+template <int N_S>
+struct thread_list {
+    bitset<N_S>     active;
+    array<int, N_S> states;
+    int             size = 0;
+
+    constexpr void clear() {
+        for (int i = 0; i < size; i++) {
+            active.reset(states[i]);
+        }
+        size = 0;
+    }
 
-        while (idx_trans < nfa.size_transition() && nfa.transitions[idx_trans].src == state) {
-            const transition& trans = nfa.transitions[idx_trans];
+    // add state and everything reachable from it through epsilon transitions
+    template <int N_T, int N_FS, bool EF>
+    constexpr void add(const finite_automata<N_T, N_FS, EF>& nfa, int state) {
+        if (active.test(state))
+            return;
+        active.set(state);
+        states[size++] = state;
 
-            if (trans.is_epsilon) {
-                st.push(std::make_pair(trans.dst, idx));
-            } else if (trans.match(target_str[idx])) {
-                st.push(std::make_pair(trans.dst, idx + 1));
+        if constexpr (EF)
+            return;
+
+        // states[size - 1 ...] doubles as the work list, each state is added once
+        for (int i = size - 1; i < size; i++) {
+            int idx_trans = nfa.lower_idx_in_trans(states[i]);
+            if (idx_trans < 0)
+                continue;
+
+            for (; idx_trans < N_T && nfa.transitions[idx_trans].src == states[i]; idx_trans++) {
+                const transition& trans = nfa.transitions[idx_trans];
+                if (trans.is_epsilon && !active.test(trans.dst)) {
+                    active.set(trans.dst);
+                    states[size++] = trans.dst;
+                }
             }
+        }
+    }
+
+    // the compact layout is epsilon-free
+    template <int N_S2, int N_T>
+    constexpr void add(const compact_automata<N_S2, N_T>&, int state) {
+        if (active.test(state))
+            return;
+        active.set(state);
+        states[size++] = state;
+    }
+};
+
+// Advances all active NFA states in lockstep over the input. Each state is
+// visited at most once per byte, so this is O(n * m) even on patterns like
+// (a*)*b where backtracking blows up, and it never allocates.
+template <int N_S, int N_T, typename It, typename Instrument = no_instrumentation>
+bool run(pike_vm_engine, const compact_automata<N_S, N_T>& nfa, It first, It last, Instrument = {}) {
+    thread_list<N_S> lists[2];
+    int              cur = 0;
+
+    lists[cur].add(nfa, 0);
+    if (nfa.is_accepting_state(0))
+        return true;
+
+    for (; first != last; ++first) {
+        unsigned char     c    = static_cast<unsigned char>(*first);
+        thread_list<N_S>& from = lists[cur];
+        thread_list<N_S>& to   = lists[cur ^ 1];
+
+        Instrument::bytes(1);
+        Instrument::states(from.size);
 
-            idx_trans++;
+        to.clear();
+        for (int i = 0; i < from.size; i++) {
+            int state = from.states[i];
+            for (int e = nfa.begin(state); e < nfa.end(state); e++) {
+                if (!nfa.edges[e].match(c))
+                    continue;
+                if (nfa.is_accepting_state(nfa.edges[e].dst))
+                    return true;
+                to.add(nfa, nfa.edges[e].dst);
+            }
         }
+
+        if (to.size == 0)
+            return false;
+        cur ^= 1;
     }
 
+    for (int i = 0; i < lists[cur].size; i++) {
+        if (nfa.is_final_state(lists[cur].states[i]))
+            return true;
+    }
     return false;
 }
 
-#endif
\ No newline at end of file
+// one bit per active Glushkov position
+template <typename It, typename Instrument = no_instrumentation>
+bool run(bit_parallel_engine, const glushkov_automata& g, It first, It last, Instrument = {}) {
+    if (first == last)
+        return g.nullable;
+
+    uint64_t d = g.first & g.masks[static_cast<unsigned char>(*first)];
+    Instrument::bytes(1);
+    for (++first; first != last; ++first) {
+        if (d == 0 || (d & g.accepting))
+            break;
+        if constexpr (Instrument::enabled)
+            Instrument::states(__builtin_popcountll(d));
+        Instrument::bytes(1);
+        d = g.step(d, static_cast<unsigned char>(*first));
+    }
+    return d & g.last;
+}
+
+template <int N_S, int STRIDE, typename It, typename Instrument = no_instrumentation>
+bool run(dfa_engine, const deterministic_automata<N_S, STRIDE>& dfa, It first, It last, Instrument = {}) {
+    int state = dfa.start_state;
+    for (; first != last && !dfa.is_decided(state); ++first) {
+        Instrument::bytes(1);
+        Instrument::states(1);
+        state = dfa.next(state, static_cast<unsigned char>(*first));
+    }
+    return dfa.is_final_state(state);
+}
+
+//
+// Compiled pattern
+//
+
+// Patterns longer than this are parsed by flat_parser. parser<> runs out of
+// template depth not far above.
+static constexpr int flat_parser_threshold = 48;
+
+// Front ends turn the pattern into what the engines are built from: the
+// literal analysis, the Glushkov automaton and the Thompson NFA.
+template <auto& pattern>
+struct type_front_end {
+    static_assert(parser<pattern, parse_table>::correct, "Regular expression syntax error");
+
+    using AST = without_captures<typename parser<pattern, parse_table>::AST>;
+
+    using literals     = literal_analysis<AST>;
+    using bit_parallel = glushkov<AST>;
+
+    static constexpr auto& thompson_nfa = build_FA(AST{});
+};
+
+template <auto& pattern>
+struct flat_front_end {
+    static_assert(flat_parser<pattern>::correct, "Regular expression syntax error");
+
+    static constexpr auto& AST = flat_parser<pattern>::res;
+
+    using literals     = flat_literal_analysis<AST>;
+    using bit_parallel = flat_glushkov<AST>;
+
+    static constexpr auto& thompson_nfa = flat_build_FA<AST>::res;
+};
+
+// What a pattern compiles to, see compiled<pattern>::stats.
+struct automaton_stats {
+    int         thompson_states     = 0;
+    int         epsilon_transitions = 0;  // in the Thompson NFA, no engine runs them
+    int         nfa_states          = 0;  // epsilon-free
+    int         nfa_transitions     = 0;
+    int         dfa_states          = 0;  // minimized, 0 if the pattern isn't determinized
+    int         dfa_transitions     = 0;  // that don't lead to the dead state, per byte
+    int         byte_classes        = 0;  // columns of the DFA table
+    size_t      table_bytes         = 0;  // of the automaton auto_engine runs
+    const char* engine              = "";  // the engine auto_engine runs
+};
+
+// Everything constexpr-ly derived from a pattern.
+template <auto& pattern>
+struct compiled {
+    static constexpr bool flat = pattern.size() > flat_parser_threshold;
+
+    using front_end = std::conditional_t<flat, flat_front_end<pattern>, type_front_end<pattern>>;
+
+    using literals       = typename front_end::literals;
+    using bit_parallel   = typename front_end::bit_parallel;
+    using remove_epsilon = FA_remove_epsilon<front_end::thompson_nfa>;
+    using determinize    = FA_determinize<remove_epsilon::res>;
+    using minimize       = FA_minimize<determinize::res>;
+
+    // the NFA straight out of Thompson's construction
+    static constexpr auto& thompson_nfa = front_end::thompson_nfa;
+
+    // all engines run on the epsilon-free FA
+    static constexpr auto& nfa = remove_epsilon::res;
+    static constexpr auto& dfa = minimize::res;
+
+    // what the NFA engines run, nfa in the layout of compact.h
+    static constexpr auto& compact = FA_compact<nfa>::res;
+
+    static constexpr int nfa_state_count = nfa.state_count();
+
+    // the engine auto_engine runs
+    using engine = std::conditional_t<bit_parallel::fits,
+                                      bit_parallel_engine,
+                                      std::conditional_t<determinize::fits, dfa_engine, lazy_dfa_engine>>;
+
+    static constexpr automaton_stats build_stats() {
+        automaton_stats res;
+
+        res.thompson_states = thompson_nfa.state_count();
+        for (const transition& t : thompson_nfa.transitions) {
+            res.epsilon_transitions += t.is_epsilon;
+        }
+        res.nfa_states      = nfa.state_count();
+        res.nfa_transitions = nfa.size_transition();
+
+        if constexpr (determinize::fits) {
+            res.dfa_states   = dfa.state_count();
+            res.byte_classes = dfa.class_count();
+            for (int s = 0; s < dfa.state_count(); s++) {
+                for (int c = 0; c < 256; c++) {
+                    res.dfa_transitions += dfa.next(s, c) != dfa.dead_state;
+                }
+            }
+        }
+
+        if constexpr (std::is_same_v<engine, bit_parallel_engine>)
+            res.table_bytes = sizeof(bit_parallel::res);
+        else if constexpr (std::is_same_v<engine, dfa_engine>)
+            res.table_bytes = sizeof(dfa);
+        else
+            res.table_bytes = sizeof(compact) + sizeof(typename lazy_dfa<compact>::cache);
+        res.engine = engine::name;
+        return res;
+    }
+
+    static constexpr automaton_stats stats = build_stats();
+};
+
+// Matches the whole of [first, last), a range of forward iterators over
+// bytes. Nothing is copied and nothing outside the range is read.
+// Instrument is a policy from instrument.h.
+template <auto& pattern, typename Engine = auto_engine, typename Instrument = no_instrumentation, typename It>
+bool match(It first, It last) {
+    using C = compiled<pattern>;
+    using E = std::conditional_t<std::is_same_v<Engine, auto_engine>, typename C::engine, Engine>;
+
+    static_assert(sizeof(typename std::iterator_traits<It>::value_type) == 1, "match expects a range of bytes");
+
+    // Reject inputs that lack the pattern's literal prefix, suffix or
+    // required factor before running any engine. Patterns that only match a
+    // single string are decided right here. Needs contiguous memory, so it
+    // only runs on pointer ranges.
+    if constexpr (std::is_pointer_v<It>) {
+        const char* data      = reinterpret_cast<const char*>(first);
+        bool        may_match = prefilter_match(C::literals::res, data, last - first);
+        if (!may_match || C::literals::res.exact) {
+            Instrument::prefilter_hit();
+            return may_match;
+        }
+    }
+
+    if constexpr (std::is_same_v<E, backtrack_engine>) {
+        return run(backtrack_engine{}, C::compact, first, last, Instrument{});
+    } else if constexpr (std::is_same_v<E, bit_parallel_engine>) {
+        static_assert(C::bit_parallel::fits, "Too many character positions for the bit-parallel engine");
+        return run(bit_parallel_engine{}, C::bit_parallel::res, first, last, Instrument{});
+    } else if constexpr (std::is_same_v<E, pike_vm_engine>) {
+        return run(pike_vm_engine{}, C::compact, first, last, Instrument{});
+    } else if constexpr (std::is_same_v<E, lazy_dfa_engine>) {
+        return run_lazy_dfa<C::compact>(first, last, Instrument{});
+    } else if constexpr (std::is_same_v<E, dfa_engine>) {
+        static_assert(C::determinize::fits, "Too many DFA states, use another engine");
+        return run(dfa_engine{}, C::dfa, first, last, Instrument{});
+    } else {
+        static_assert(std::is_same_v<E, codegen_engine>, "Unknown engine");
+        static_assert(C::determinize::fits, "Too many DFA states, use another engine");
+        return run_codegen<C::dfa>(first, last, Instrument{});
+    }
+}
+
+template <auto& pattern, typename Engine = auto_engine, typename Instrument = no_instrumentation>
+bool match(const char* data, size_t size) {
+    return match<pattern, Engine, Instrument>(data, data + size);
+}
+
+// also takes std::string and string literals without copying
+template <auto& pattern, typename Engine = auto_engine, typename Instrument = no_instrumentation>
+bool match(std::string_view target_str) {
+    return match<pattern, Engine, Instrument>(target_str.data(), target_str.data() + target_str.size());
+}
+
+#endif
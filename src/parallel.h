@@ -0,0 +1,346 @@
+#ifndef CTRE_PARALLEL_H
+#define CTRE_PARALLEL_H
+
+#include "match.h"
+#include "search.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+//
+// Thread pool
+//
+
+// Runs parallel_for's tasks on a fixed set of std::threads and the calling
+// thread. One parallel_for runs at a time, tasks must not throw.
+class thread_pool {
+  public:
+    explicit thread_pool(unsigned n_threads = std::thread::hardware_concurrency()) {
+        // the calling thread works too
+        for (unsigned i = 1; i < n_threads; i++) {
+            workers.emplace_back([this] { work(); });
+        }
+    }
+
+    ~thread_pool() {
+        {
+            std::lock_guard<std::mutex> lock(m);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& t : workers) {
+            t.join();
+        }
+    }
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    // threads that run tasks, the calling thread included
+    unsigned size() const {
+        return static_cast<unsigned>(workers.size()) + 1;
+    }
+
+    // runs f(0) .. f(n - 1) and returns when all of them are done
+    template <typename F>
+    void parallel_for(size_t n, F&& f) {
+        std::lock_guard<std::mutex> one_at_a_time(busy);
+
+        std::function<void(size_t)> fn(std::ref(f));
+        batch                       b;
+        b.f     = &fn;
+        b.n     = n;
+        b.users = 1;
+        {
+            std::lock_guard<std::mutex> lock(m);
+            current = &b;
+            generation++;
+        }
+        wake.notify_all();
+
+        size_t done = run(b);
+
+        std::unique_lock<std::mutex> lock(m);
+        b.users--;
+        b.done += done;
+        finished.wait(lock, [&] { return b.done == b.n && b.users == 0; });
+        current = nullptr;
+    }
+
+  private:
+    struct batch {
+        const std::function<void(size_t)>* f = nullptr;
+        size_t                             n = 0;
+        std::atomic<size_t>                next{ 0 };
+        size_t                             done  = 0;  // guarded by m
+        int                                users = 0;  // threads inside run(), guarded by m
+    };
+
+    // takes tasks until there are none left, returns how many it ran
+    static size_t run(batch& b) {
+        size_t done = 0;
+        for (size_t i; (i = b.next++) < b.n; done++) {
+            (*b.f)(i);
+        }
+        return done;
+    }
+
+    void work() {
+        uint64_t seen = 0;
+        while (true) {
+            std::unique_lock<std::mutex> lock(m);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping)
+                return;
+            seen = generation;
+
+            // the batch may be over already
+            batch* b = current;
+            if (!b)
+                continue;
+            b->users++;
+            lock.unlock();
+
+            size_t done = run(*b);
+
+            lock.lock();
+            b->users--;
+            b->done += done;
+            if (b->done == b->n && b->users == 0)
+                finished.notify_all();
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::mutex               busy;
+    std::mutex               m;
+    std::condition_variable  wake;
+    std::condition_variable  finished;
+    batch*                   current    = nullptr;
+    uint64_t                 generation = 0;
+    bool                     stopping   = false;
+};
+
+// one thread per core, created on first use
+inline thread_pool& default_thread_pool() {
+    static thread_pool pool;
+    return pool;
+}
+
+//
+// Chunked DFA walks
+//
+
+// Inputs are cut into chunks of at least this many bytes, smaller inputs
+// are matched on the calling thread.
+static constexpr size_t parallel_min_chunk = 1 << 16;
+
+// chunks per thread, so a slow chunk doesn't hold up the others
+static constexpr size_t parallel_chunks_per_thread = 4;
+
+// What a chunk does to every state it may be entered in: the state it
+// leaves in and where in the input the last final state was reached.
+template <int N_S>
+struct chunk_map {
+    static constexpr size_t none = size_t(-1);
+
+    array<int, N_S>    end_state;
+    array<size_t, N_S> last_final;
+};
+
+// Walks data[0, size) from every state at once, or only from the starting
+// state for the first chunk. Walks that arrive in the same state stay
+// together from there on, they are merged every block so the work shrinks
+// to a single walk once the DFA synchronizes, which most do within a few
+// bytes. `offset` is where data starts in the whole input.
+template <bool TRACK_FINAL, int N_S, int STRIDE>
+void walk_chunk(const deterministic_automata<N_S, STRIDE>& dfa,
+                const char*                                data,
+                size_t                                     size,
+                size_t                                     offset,
+                bool                                       from_start,
+                chunk_map<N_S>&                            out) {
+    constexpr size_t block = 64;
+    constexpr size_t none  = chunk_map<N_S>::none;
+
+    // walk w started in state w, until it merged into merged_into[w] at
+    // position merged_at[w]
+    array<int, N_S>    state;
+    array<size_t, N_S> last_final;
+    array<int, N_S>    merged_into;
+    array<size_t, N_S> merged_at;
+    array<int, N_S>    live;
+    array<int, N_S>    owner;
+    int                n_live = 0;
+
+    for (int s = 0; s < N_S; s++) {
+        state[s]       = s;
+        last_final[s]  = none;
+        merged_into[s] = -1;
+        owner[s]       = -1;
+        if (s != dfa.dead_state && (!from_start || s == dfa.start_state))
+            live[n_live++] = s;
+    }
+
+    // nothing leaves the dead state, walk 0 stays there without moving and
+    // walks that die merge into it
+    owner[dfa.dead_state] = dfa.dead_state;
+
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+    for (size_t idx = 0; idx < size && n_live > 0;) {
+        // a single walk takes the rest of the chunk in one go
+        size_t n = n_live == 1 ? size - idx : size - idx < block ? size - idx : block;
+
+        for (int i = 0; i < n_live; i++) {
+            int    w = live[i];
+            int    s = state[w];
+            size_t f = last_final[w];
+            for (const unsigned char *it = bytes + idx, *end = it + n; it != end; ++it) {
+                s = dfa.next(s, *it);
+                if (TRACK_FINAL && dfa.is_final_state(s))
+                    f = offset + (it - bytes) + 1;
+            }
+            state[w]      = s;
+            last_final[w] = f;
+        }
+        idx += n;
+
+        // merge walks in the same state
+        int kept = 0;
+        for (int i = 0; i < n_live; i++) {
+            int w = live[i];
+            if (owner[state[w]] < 0) {
+                owner[state[w]] = w;
+                live[kept++]    = w;
+            } else {
+                merged_into[w] = owner[state[w]];
+                merged_at[w]   = offset + idx;
+            }
+        }
+        n_live = kept;
+        for (int i = 0; i < n_live; i++) {
+            owner[state[live[i]]] = -1;
+        }
+    }
+
+    // Walks are only merged into live walks or the dead one, so following
+    // merged_into ends at one of those. A final state reached after the
+    // merge counts for both walks, one before it only for its own.
+    for (int s = 0; s < N_S; s++) {
+        if (from_start && s != dfa.start_state)
+            continue;
+
+        int    w = s;
+        size_t f = last_final[w];
+        while (merged_into[w] >= 0) {
+            size_t after = merged_at[w];
+            w            = merged_into[w];
+            if (last_final[w] != none && last_final[w] >= after)
+                f = last_final[w];
+        }
+        out.end_state[s]  = state[w];
+        out.last_final[s] = f;
+    }
+}
+
+// Splits [from, size) into chunks and walks each on the pool.
+template <bool TRACK_FINAL, int N_S, int STRIDE>
+std::vector<chunk_map<N_S>> walk_chunks(const deterministic_automata<N_S, STRIDE>& dfa,
+                                        std::string_view                           input,
+                                        size_t                                     from,
+                                        size_t                                     n_chunks,
+                                        thread_pool&                               pool) {
+    std::vector<chunk_map<N_S>> maps(n_chunks);
+    size_t                      length = input.size() - from;
+
+    pool.parallel_for(n_chunks, [&](size_t i) {
+        size_t begin = from + length * i / n_chunks;
+        size_t end   = from + length * (i + 1) / n_chunks;
+        walk_chunk<TRACK_FINAL>(dfa, input.data() + begin, end - begin, begin, i == 0, maps[i]);
+    });
+    return maps;
+}
+
+inline size_t parallel_chunk_count(size_t length, const thread_pool& pool) {
+    size_t by_size    = length / parallel_min_chunk;
+    size_t by_threads = size_t(pool.size()) * parallel_chunks_per_thread;
+    return by_size < by_threads ? by_size : by_threads;
+}
+
+//
+// Parallel match and search
+//
+
+// match and search for large inputs. The input is cut into chunks that are
+// walked concurrently from every DFA state, the walks are then chained
+// from the starting state. Patterns without a DFA, and inputs of less than
+// two chunks, run match or search on the calling thread.
+template <auto& pattern>
+bool match_parallel(std::string_view input, thread_pool& pool = default_thread_pool()) {
+    using C = compiled<pattern>;
+
+    size_t n_chunks = parallel_chunk_count(input.size(), pool);
+    if constexpr (!C::determinize::fits)
+        return match<pattern>(input);
+    else {
+        if (n_chunks < 2)
+            return match<pattern>(input);
+        bool may_match = prefilter_match(C::literals::res, input.data(), input.size());
+        if (!may_match || C::literals::res.exact)
+            return may_match;
+
+        auto maps  = walk_chunks<false>(C::dfa, input, 0, n_chunks, pool);
+        int  state = C::dfa.start_state;
+        for (const auto& map : maps) {
+            state = map.end_state[state];
+        }
+        return C::dfa.is_final_state(state);
+    }
+}
+
+template <auto& pattern>
+search_result search_parallel(std::string_view input, thread_pool& pool = default_thread_pool()) {
+    using C = compiled<pattern>;
+    using S = compiled_search<pattern>;
+
+    if constexpr (!S::dfa_fits)
+        return search<pattern>(input);
+    else {
+        size_t from = search_from(C::literals::res, input);
+        if (from == size_t(-1))
+            return {};
+
+        size_t n_chunks = parallel_chunk_count(input.size() - from, pool);
+        if (n_chunks < 2)
+            return search<pattern>(input);
+
+        constexpr auto& fwd  = S::forward::res;
+        constexpr auto  none = chunk_map<fwd.state_count()>::none;
+
+        auto   maps  = walk_chunks<true>(fwd, input, from, n_chunks, pool);
+        int    state = fwd.start_state;
+        bool   found = fwd.is_final_state(state);
+        size_t end   = from;
+        for (const auto& map : maps) {
+            if (map.last_final[state] != none) {
+                found = true;
+                end   = map.last_final[state];
+            }
+            state = map.end_state[state];
+            if (state == fwd.dead_state)
+                break;
+        }
+
+        if (!found)
+            return {};
+        size_t start = match_start(S::reverse::res, input.data(), end);
+        return { true, start, end - start };
+    }
+}
+
+#endif
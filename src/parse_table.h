@@ -1,17 +1,17 @@
 // Grammar:
 // S -> E $  $ - the special EOF symbol
 
-// E ->  character mod seq alt
+// E ->  atom mod seq alt
 // E -> ( alt0 ) mod seq alt
 // E -> epsilon
 
-// seq0 -> character mod seq
+// seq0 -> atom mod seq
 // seq0 -> ( alt0 ) mod seq
 // seq -> ( alt0 ) mod seq
-// seq -> character mod seq
+// seq -> atom mod seq
 // seq -> epsilon
 
-// alt0 -> character mod seq alt
+// alt0 -> atom mod seq alt
 // alt0 -> ( alt0 ) mod seq alt
 // alt -> | seq0 alt
 // alt -> epsilon
@@ -19,12 +19,41 @@
 // mod -> *
 // mod -> +
 // mod -> ?
+// mod -> { rep_min
 // mod -> epsilon
 
+// rep_min -> digit rep_min_more
+// rep_min_more -> digit rep_min_more
+// rep_min_more -> , rep_max
+// rep_min_more -> }
+// rep_max -> digit rep_max_more
+// rep_max -> }
+// rep_max_more -> digit rep_max_more
+// rep_max_more -> }
+
+// atom -> character
+// atom -> .
+// atom -> \ esc
+// atom -> [ class0 ]
+
+// class0 -> ^ class_item class_items
+// class0 -> class_item class_items
+// class_items -> class_item class_items
+// class_items -> epsilon
+// class_item -> character range
+// class_item -> \ class_esc range
+// range -> - range_end
+// range -> epsilon
+// range_end -> character
+// range_end -> \ range_esc
+// range_end -> epsilon  when followed by ], the - is a character
+
 #ifndef CTRE_PARSE_TABLE_H
 #define CTRE_PARSE_TABLE_H
 
+#include "char_class.h"
 #include "stack.h"
+#include <type_traits>
 
 // parser operations
 struct reject {};
@@ -49,6 +78,20 @@ struct AST_action {};
 template <char C>
 struct ch {};
 
+// bytes LO to HI of a class
+template <char LO, char HI>
+struct char_range {};
+
+// \d \w \s and their negations inside a class
+template <char C>
+struct class_escape {};
+
+// [...], . and the class escapes. Items are char_range and class_escape in
+// no particular order, the class matches the bytes of any of them, or of
+// none of them if it is NEGATED.
+template <bool NEGATED, typename... Items>
+struct char_class {};
+
 // |
 template <typename... Ts>
 struct alter {};
@@ -65,9 +108,143 @@ struct star {};
 template <typename T>
 using plus = concat<T, star<T>>;
 
-// ?
+// ?, greedy like *: T is the preferred alternative
+template <typename T>
+using opt = alter<T, epsilon>;
+
+// {MIN,MAX}, MAX is -1 for {MIN,}. The automata share one copy of T's
+// construction rather than nesting MAX concats, see FA_repeat.
+template <int MIN, int MAX, typename T>
+struct repeat {};
+
+// counts in {m,n} above this are a syntax error
+static constexpr int repeat_limit = 1000;
+
+// value * 10 + the digit c, -1 if c isn't a digit or the count gets too large
+constexpr int repeat_count(int value, char c) {
+    if (c < '0' || c > '9')
+        return -1;
+    value = value * 10 + (c - '0');
+    return value > repeat_limit ? -1 : value;
+}
+
+// ( ), ID counts groups from 0 in the order they open
+template <int ID, typename T>
+struct capture {};
+
+// marks an open group on the AST stack until its ) is reached
+template <int ID>
+struct open_group {};
+
+// the bytes a class matches
+template <char LO, char HI>
+constexpr byte_set class_bytes(char_range<LO, HI>) {
+    byte_set res;
+    add_range(res, LO, HI);
+    return res;
+}
+
+template <char C>
+constexpr byte_set class_bytes(class_escape<C>) {
+    return escape_set(C);
+}
+
+template <bool NEGATED, typename... Items>
+constexpr byte_set class_bytes(char_class<NEGATED, Items...>) {
+    byte_set res;
+    ((res |= class_bytes(Items{})), ...);
+    return NEGATED ? complement(res) : res;
+}
+
+// class_bytes with linkage, for templates that take it by reference
+template <typename Class>
+struct class_set {
+    static constexpr byte_set res = class_bytes(Class{});
+};
+
+// highest group ID in an AST, -1 if it has no groups
+template <char C>
+constexpr int max_group(ch<C>) {
+    return -1;
+}
+
+template <bool NEGATED, typename... Items>
+constexpr int max_group(char_class<NEGATED, Items...>) {
+    return -1;
+}
+
+constexpr int max_group(epsilon) {
+    return -1;
+}
+
+template <int ID>
+constexpr int max_group(open_group<ID>) {
+    return ID;
+}
+
+template <int ID, typename T>
+constexpr int max_group(capture<ID, T>) {
+    return ID > max_group(T{}) ? ID : max_group(T{});
+}
+
 template <typename T>
-using opt = alter<epsilon, T>;
+constexpr int max_group(star<T>) {
+    return max_group(T{});
+}
+
+template <int MIN, int MAX, typename T>
+constexpr int max_group(repeat<MIN, MAX, T>) {
+    return max_group(T{});
+}
+
+template <typename... Ts>
+constexpr int max_group(concat<Ts...>) {
+    int res = -1;
+    ((res = max_group(Ts{}) > res ? max_group(Ts{}) : res), ...);
+    return res;
+}
+
+template <typename... Ts>
+constexpr int max_group(alter<Ts...>) {
+    int res = -1;
+    ((res = max_group(Ts{}) > res ? max_group(Ts{}) : res), ...);
+    return res;
+}
+
+template <typename... Ts>
+constexpr int max_group(stack<Ts...>) {
+    int res = -1;
+    ((res = max_group(Ts{}) > res ? max_group(Ts{}) : res), ...);
+    return res;
+}
+
+// the same AST with the groups dropped, for everything that only
+// needs to know whether the input matches
+template <char C>
+auto strip_captures(ch<C>) -> ch<C>;
+
+template <bool NEGATED, typename... Items>
+auto strip_captures(char_class<NEGATED, Items...>) -> char_class<NEGATED, Items...>;
+
+auto strip_captures(epsilon) -> epsilon;
+
+template <int ID, typename T>
+auto strip_captures(capture<ID, T>) -> decltype(strip_captures(T{}));
+
+template <typename T>
+auto strip_captures(star<T>) -> star<decltype(strip_captures(T{}))>;
+
+template <int MIN, int MAX, typename T>
+auto strip_captures(repeat<MIN, MAX, T>) -> repeat<MIN, MAX, decltype(strip_captures(T{}))>;
+
+template <typename... Ts>
+auto strip_captures(concat<Ts...>) -> concat<decltype(strip_captures(Ts{}))...>;
+
+template <typename... Ts>
+auto strip_captures(alter<Ts...>) -> alter<decltype(strip_captures(Ts{}))...>;
+
+template <typename AST>
+using without_captures = decltype(strip_captures(AST{}));
 
 //
 //
@@ -81,6 +258,18 @@ struct parse_table {
     struct seq0 {};
     struct seq {};
     struct mod {};
+    struct rep_min {};
+    struct rep_min_more {};
+    struct rep_max {};
+    struct rep_max_more {};
+    struct esc {};
+    struct class0 {};
+    struct class_item {};
+    struct class_items {};
+    struct class_esc {};
+    struct range {};
+    struct range_end {};
+    struct range_esc {};
 
     // the starting symbol
     using S = E;
@@ -95,6 +284,100 @@ struct parse_table {
     struct _star : AST_action {};
     struct _plus : AST_action {};
     struct _opt : AST_action {};
+    struct _repeat : AST_action {};
+    struct _min_digit : AST_action {};
+    struct _max_digit : AST_action {};
+    struct _repeat_exact : AST_action {};
+    struct _repeat_open_ended : AST_action {};
+    struct _repeat_close : AST_action {};
+    struct _open : AST_action {};
+    struct _capture : AST_action {};
+    struct _any : AST_action {};
+    struct _escape : AST_action {};
+    struct _class_open : AST_action {};
+    struct _negate : AST_action {};
+    struct _class_char : AST_action {};
+    struct _class_escape : AST_action {};
+    struct _range_end : AST_action {};
+    struct _range_end_escape : AST_action {};
+
+    //
+    // escapes and ranges, reject on errors
+    //
+
+    // \C outside of a class
+    template <char C>
+    static constexpr auto escape_AST() {
+        constexpr int b = escape_byte(C);
+        if constexpr (b == -2)
+            return reject{};
+        else if constexpr (b == -1)
+            return char_class<false, class_escape<C>>{};
+        else
+            return ch<static_cast<char>(b)>{};
+    }
+
+    template <char C, typename... Ts>
+    static constexpr auto push_escape(stack<Ts...>) {
+        using T = decltype(escape_AST<C>());
+        if constexpr (std::is_same_v<T, reject>)
+            return reject{};
+        else
+            return stack<T, Ts...>{};
+    }
+
+    // \C inside a class
+    template <char C, bool NEGATED, typename... Items, typename... Ts>
+    static constexpr auto add_class_escape(stack<char_class<NEGATED, Items...>, Ts...>) {
+        constexpr int b = escape_byte(C);
+        if constexpr (b == -2)
+            return reject{};
+        else if constexpr (b == -1)
+            return stack<char_class<NEGATED, class_escape<C>, Items...>, Ts...>{};
+        else
+            return stack<char_class<NEGATED, char_range<static_cast<char>(b), static_cast<char>(b)>, Items...>, Ts...>{};
+    }
+
+    // the single byte LO just added becomes the range LO-HI, HI is -1 for
+    // an escape that isn't a single byte
+    template <char LO, int HI, bool NEGATED, typename... Items, typename... Ts>
+    static constexpr auto close_range(stack<char_class<NEGATED, char_range<LO, LO>, Items...>, Ts...>) {
+        if constexpr (HI < static_cast<unsigned char>(LO))
+            return reject{};
+        else
+            return stack<char_class<NEGATED, char_range<LO, static_cast<char>(HI)>, Items...>, Ts...>{};
+    }
+
+    //
+    // {m,n}, the counts are read into repeat<MIN, MAX, T> one digit at a
+    // time, MAX starts at 0
+    //
+
+    template <char C, int MIN, int MAX, typename T, typename... Ts>
+    static constexpr auto min_digit(stack<repeat<MIN, MAX, T>, Ts...>) {
+        constexpr int n = repeat_count(MIN, C);
+        if constexpr (n < 0)
+            return reject{};
+        else
+            return stack<repeat<n, MAX, T>, Ts...>{};
+    }
+
+    template <char C, int MIN, int MAX, typename T, typename... Ts>
+    static constexpr auto max_digit(stack<repeat<MIN, MAX, T>, Ts...>) {
+        constexpr int n = repeat_count(MAX, C);
+        if constexpr (n < 0)
+            return reject{};
+        else
+            return stack<repeat<MIN, n, T>, Ts...>{};
+    }
+
+    template <int MIN, int MAX, typename T, typename... Ts>
+    static constexpr auto close_repeat(stack<repeat<MIN, MAX, T>, Ts...>) {
+        if constexpr (MAX < MIN)
+            return reject{};
+        else
+            return stack<repeat<MIN, MAX, T>, Ts...>{};
+    }
 
     //
     // AST builder
@@ -124,6 +407,65 @@ struct parse_table {
     template <char C, typename T, typename... Ts>
     static auto build_AST(_opt, character<C>, stack<T, Ts...>) -> stack<opt<T>, Ts...>;
 
+    template <char C, typename T, typename... Ts>
+    static auto build_AST(_repeat, character<C>, stack<T, Ts...>) -> stack<repeat<0, 0, T>, Ts...>;
+
+    template <char C, typename... Ts>
+    static auto build_AST(_min_digit, character<C>, stack<Ts...> ast) -> decltype(min_digit<C>(ast));
+
+    template <char C, typename... Ts>
+    static auto build_AST(_max_digit, character<C>, stack<Ts...> ast) -> decltype(max_digit<C>(ast));
+
+    template <char C, int MIN, int MAX, typename T, typename... Ts>
+    static auto build_AST(_repeat_exact, character<C>, stack<repeat<MIN, MAX, T>, Ts...>) -> stack<repeat<MIN, MIN, T>, Ts...>;
+
+    template <char C, int MIN, int MAX, typename T, typename... Ts>
+    static auto build_AST(_repeat_open_ended, character<C>, stack<repeat<MIN, MAX, T>, Ts...>) -> stack<repeat<MIN, -1, T>, Ts...>;
+
+    template <char C, typename... Ts>
+    static auto build_AST(_repeat_close, character<C>, stack<Ts...> ast) -> decltype(close_repeat(ast));
+
+    // every group opened so far is somewhere on the stack
+    template <char C, typename... Ts>
+    static auto build_AST(_open, character<C>, stack<Ts...>) -> stack<open_group<max_group(stack<Ts...>{}) + 1>, Ts...>;
+
+    template <char C, typename T, int ID, typename... Ts>
+    static auto build_AST(_capture, character<C>, stack<T, open_group<ID>, Ts...>) -> stack<capture<ID, T>, Ts...>;
+
+    template <char C, typename... Ts>
+    static auto build_AST(_any, character<C>, stack<Ts...>) -> stack<char_class<true, char_range<'\n', '\n'>>, Ts...>;
+
+    template <char C, typename... Ts>
+    static auto build_AST(_escape, character<C>, stack<Ts...> ast) -> decltype(push_escape<C>(ast));
+
+    template <char C, typename... Ts>
+    static auto build_AST(_class_open, character<C>, stack<Ts...>) -> stack<char_class<false>, Ts...>;
+
+    template <char C, typename... Items, typename... Ts>
+    static auto build_AST(_negate, character<C>, stack<char_class<false, Items...>, Ts...>) -> stack<char_class<true, Items...>, Ts...>;
+
+    template <char C, bool NEGATED, typename... Items, typename... Ts>
+    static auto build_AST(_class_char, character<C>, stack<char_class<NEGATED, Items...>, Ts...>)
+        -> stack<char_class<NEGATED, char_range<C, C>, Items...>, Ts...>;
+
+    template <char C, typename... Ts>
+    static auto build_AST(_class_escape, character<C>, stack<Ts...> ast) -> decltype(add_class_escape<C>(ast));
+
+    // a range needs a single byte on both ends
+    template <char C, bool NEGATED, char LO, typename... Items, typename... Ts>
+    static auto build_AST(_range_end, character<C>, stack<char_class<NEGATED, char_range<LO, LO>, Items...>, Ts...> ast)
+        -> decltype(close_range<LO, static_cast<unsigned char>(C)>(ast));
+
+    template <char C, bool NEGATED, char LO, typename... Items, typename... Ts>
+    static auto build_AST(_range_end_escape, character<C>, stack<char_class<NEGATED, char_range<LO, LO>, Items...>, Ts...> ast)
+        -> decltype(close_range<LO, escape_byte(C) < 0 ? -1 : escape_byte(C)>(ast));
+
+    template <char C, typename T>
+    static auto build_AST(_range_end, character<C>, T) -> reject;
+
+    template <char C, typename T>
+    static auto build_AST(_range_end_escape, character<C>, T) -> reject;
+
     //
     // the parse table
     //
@@ -136,30 +478,40 @@ struct parse_table {
 
     //////
     // E
-    static auto f(E, character<'('>) -> stack<character<'('>, alt0, character<')'>, mod, seq, alt>;
+    static auto f(E, character<'('>) -> stack<character<'('>, _open, alt0, character<')'>, _capture, mod, seq, alt>;
 
     template <char C>
     static auto f(E, character<C>) -> stack<character<C>, _char, mod, seq, alt>;
 
+    static auto f(E, character<'.'>) -> stack<character<'.'>, _any, mod, seq, alt>;
+    static auto f(E, character<'\\'>) -> stack<character<'\\'>, esc, mod, seq, alt>;
+    static auto f(E, character<'['>) -> stack<character<'['>, _class_open, class0, character<']'>, mod, seq, alt>;
+
     static auto f(E, epsilon) -> pass;
 
     static auto f(E, character<')'>) -> reject;
     static auto f(E, character<'*'>) -> reject;
     static auto f(E, character<'+'>) -> reject;
     static auto f(E, character<'?'>) -> reject;
+    static auto f(E, character<'{'>) -> reject;
     static auto f(E, character<'|'>) -> reject;
 
     //////
     // alt0
-    static auto f(alt0, character<'('>) -> stack<character<'('>, alt0, character<')'>, mod, seq, alt>;
+    static auto f(alt0, character<'('>) -> stack<character<'('>, _open, alt0, character<')'>, _capture, mod, seq, alt>;
 
     template <char C>
     static auto f(alt0, character<C>) -> stack<character<C>, _char, mod, seq, alt>;
 
+    static auto f(alt0, character<'.'>) -> stack<character<'.'>, _any, mod, seq, alt>;
+    static auto f(alt0, character<'\\'>) -> stack<character<'\\'>, esc, mod, seq, alt>;
+    static auto f(alt0, character<'['>) -> stack<character<'['>, _class_open, class0, character<']'>, mod, seq, alt>;
+
     static auto f(alt0, character<')'>) -> reject;
     static auto f(alt0, character<'*'>) -> reject;
     static auto f(alt0, character<'+'>) -> reject;
     static auto f(alt0, character<'?'>) -> reject;
+    static auto f(alt0, character<'{'>) -> reject;
     static auto f(alt0, character<'|'>) -> reject;
     static auto f(alt0, epsilon) -> reject;
 
@@ -174,6 +526,7 @@ struct parse_table {
     static auto f(alt, character<'*'>) -> reject;
     static auto f(alt, character<'+'>) -> reject;
     static auto f(alt, character<'?'>) -> reject;
+    static auto f(alt, character<'{'>) -> reject;
 
     template <char C>
     static auto f(alt, character<C>) -> reject;
@@ -183,6 +536,7 @@ struct parse_table {
     static auto f(mod, character<'+'>) -> stack<character<'+'>, _plus>;
     static auto f(mod, character<'?'>) -> stack<character<'?'>, _opt>;
     static auto f(mod, character<'*'>) -> stack<character<'*'>, _star>;
+    static auto f(mod, character<'{'>) -> stack<character<'{'>, _repeat, rep_min>;
 
     static auto f(mod, character<'('>) -> pass;
     static auto f(mod, character<')'>) -> pass;
@@ -193,23 +547,55 @@ struct parse_table {
 
     static auto f(mod, epsilon) -> pass;
 
+    //////
+    // rep_min, at least one digit
+    template <char C>
+    static auto f(rep_min, character<C>) -> stack<character<C>, _min_digit, rep_min_more>;
+
+    //////
+    // rep_min_more
+    static auto f(rep_min_more, character<','>) -> stack<character<','>, rep_max>;
+    static auto f(rep_min_more, character<'}'>) -> stack<character<'}'>, _repeat_exact>;
+
+    template <char C>
+    static auto f(rep_min_more, character<C>) -> stack<character<C>, _min_digit, rep_min_more>;
+
+    //////
+    // rep_max
+    static auto f(rep_max, character<'}'>) -> stack<character<'}'>, _repeat_open_ended>;
+
+    template <char C>
+    static auto f(rep_max, character<C>) -> stack<character<C>, _max_digit, rep_max_more>;
+
+    //////
+    // rep_max_more
+    static auto f(rep_max_more, character<'}'>) -> stack<character<'}'>, _repeat_close>;
+
+    template <char C>
+    static auto f(rep_max_more, character<C>) -> stack<character<C>, _max_digit, rep_max_more>;
+
     //////
     // seq0
-    static auto f(seq0, character<'('>) -> stack<character<'('>, alt0, character<')'>, mod, seq>;
+    static auto f(seq0, character<'('>) -> stack<character<'('>, _open, alt0, character<')'>, _capture, mod, seq>;
 
     template <char C>
     static auto f(seq0, character<C>) -> stack<character<C>, _char, mod, seq>;
 
+    static auto f(seq0, character<'.'>) -> stack<character<'.'>, _any, mod, seq>;
+    static auto f(seq0, character<'\\'>) -> stack<character<'\\'>, esc, mod, seq>;
+    static auto f(seq0, character<'['>) -> stack<character<'['>, _class_open, class0, character<']'>, mod, seq>;
+
     static auto f(seq0, character<')'>) -> reject;
     static auto f(seq0, character<'*'>) -> reject;
     static auto f(seq0, character<'+'>) -> reject;
     static auto f(seq0, character<'?'>) -> reject;
+    static auto f(seq0, character<'{'>) -> reject;
     static auto f(seq0, character<'|'>) -> reject;
     static auto f(seq0, epsilon) -> reject;
 
     //////
     // seq
-    static auto f(seq, character<'('>) -> stack<character<'('>, alt0, character<')'>, mod, _concat, seq>;
+    static auto f(seq, character<'('>) -> stack<character<'('>, _open, alt0, character<')'>, _capture, mod, _concat, seq>;
 
     static auto f(seq, character<')'>) -> pass;
     static auto f(seq, character<'|'>) -> pass;
@@ -218,9 +604,67 @@ struct parse_table {
     template <char C>
     static auto f(seq, character<C>) -> stack<character<C>, _char, mod, _concat, seq>;
 
+    static auto f(seq, character<'.'>) -> stack<character<'.'>, _any, mod, _concat, seq>;
+    static auto f(seq, character<'\\'>) -> stack<character<'\\'>, esc, mod, _concat, seq>;
+    static auto f(seq, character<'['>) -> stack<character<'['>, _class_open, class0, character<']'>, mod, _concat, seq>;
+
     static auto f(seq, character<'*'>) -> reject;
     static auto f(seq, character<'+'>) -> reject;
     static auto f(seq, character<'?'>) -> reject;
+    static auto f(seq, character<'{'>) -> reject;
+
+    //////
+    // esc, outside of a class
+    template <char C>
+    static auto f(esc, character<C>) -> stack<character<C>, _escape>;
+
+    //////
+    // class0, right after [
+    static auto f(class0, character<'^'>) -> stack<character<'^'>, _negate, class_item, class_items>;
+
+    template <char C>
+    static auto f(class0, character<C>) -> stack<class_item, class_items>;
+
+    //////
+    // class_items
+    static auto f(class_items, character<']'>) -> pass;
+
+    template <char C>
+    static auto f(class_items, character<C>) -> stack<class_item, class_items>;
+
+    //////
+    // class_item, classes can't be empty
+    static auto f(class_item, character<'\\'>) -> stack<character<'\\'>, class_esc, range>;
+    static auto f(class_item, character<']'>) -> reject;
+
+    template <char C>
+    static auto f(class_item, character<C>) -> stack<character<C>, _class_char, range>;
+
+    //////
+    // class_esc
+    template <char C>
+    static auto f(class_esc, character<C>) -> stack<character<C>, _class_escape>;
+
+    //////
+    // range
+    static auto f(range, character<'-'>) -> stack<character<'-'>, range_end>;
+
+    template <char C>
+    static auto f(range, character<C>) -> pass;
+
+    //////
+    // range_end, a - right before ] is a character, the one _class_char
+    // reads
+    static auto f(range_end, character<']'>) -> stack<_class_char>;
+    static auto f(range_end, character<'\\'>) -> stack<character<'\\'>, range_esc>;
+
+    template <char C>
+    static auto f(range_end, character<C>) -> stack<character<C>, _range_end>;
+
+    //////
+    // range_esc
+    template <char C>
+    static auto f(range_esc, character<C>) -> stack<character<C>, _range_end_escape>;
 
     //////
     // accept & reject
@@ -40,7 +40,11 @@ class parser {
         if constexpr (is_AST_action(symbol)) {
             auto new_ast = decltype(Grammar::build_AST(symbol, fstr_at<IDX - 1>(), ast)){};
 
-            return parse<IDX>(pop(st), new_ast);
+            // actions reject what the table can't see, e.g. unknown escapes
+            if constexpr (std::is_same_v<decltype(new_ast), reject>)
+                return std::make_pair(false, ast);
+            else
+                return parse<IDX>(pop(st), new_ast);
         } else {
             auto op = decltype(Grammar::f(symbol, fstr_at<IDX>())){};
 
@@ -0,0 +1,97 @@
+#ifndef CTRE_REGEX_SET_H
+#define CTRE_REGEX_SET_H
+
+#include "lazy_dfa.h"
+#include "match.h"
+#include <string_view>
+
+// Matches the input against every pattern in one pass. The patterns' FAs
+// are joined by FA_union and determinized together; each DFA state carries
+// the set of patterns whose final states it contains. Sets whose DFA is over
+// budget, such as a few dozen patterns or more, run on the lazy DFA over
+// the patterns' epsilon-free FAs joined by FA_epsilon_free_union.
+template <auto&... patterns>
+class regex_set {
+  public:
+    static constexpr int pattern_count = sizeof...(patterns);
+
+    // bit i is set if patterns...[i] matched
+    using result = bitset<pattern_count>;
+
+  private:
+    using U = FA_union<compiled<patterns>::thompson_nfa...>;
+    using D = FA_determinize<U::res>;
+
+    using E = FA_epsilon_free_union<compiled<patterns>::nfa...>;
+
+    static constexpr auto& compact = FA_compact<E::res>::res;
+
+    // -1 for the shared starting state, offset is U's or E's
+    static constexpr int pattern_of(const array<int, pattern_count + 1>& offset, int nfa_state) {
+        for (int i = 0; i < pattern_count; i++) {
+            if (nfa_state < offset[i + 1])
+                return nfa_state < offset[i] ? -1 : i;
+        }
+        return -1;
+    }
+
+    static constexpr auto build_accepts() {
+        array<result, D::res.state_count()> res;
+        for (int s = 0; s < D::res.state_count(); s++) {
+            for (int fs : U::res.final_states) {
+                if (D::subsets[s].test(fs))
+                    res[s].set(pattern_of(U::offset, fs));
+            }
+        }
+        return res;
+    }
+
+    static constexpr auto accepts = build_accepts();
+
+    // the patterns whose final states are in set, a set of E's states
+    static result accepts_of(const typename lazy_dfa<compact>::state_set& set) {
+        result res;
+        if (set.test(0))
+            res = E::start_final;
+        for (int fs : E::res.final_states) {
+            if (fs > 0 && set.test(fs))
+                res.set(pattern_of(E::offset, fs));
+        }
+        return res;
+    }
+
+  public:
+    static constexpr bool dfa_fits = D::fits;
+
+    static result match(std::string_view target_str) {
+        if constexpr (dfa_fits) {
+            int state = D::res.start_state;
+            for (char c : target_str) {
+                state = D::res.next(state, static_cast<unsigned char>(c));
+                if (state == D::res.dead_state)
+                    break;
+            }
+            return accepts[state];
+        } else {
+            // a pattern that accepts whatever follows doesn't decide the
+            // others, only the empty set stops the run early
+            return accepts_of(run_lazy_dfa_states<compact, false>(target_str.begin(), target_str.end()));
+        }
+    }
+
+    static result match(const char* data, size_t size) {
+        return match(std::string_view(data, size));
+    }
+
+    // index of the first pattern that matched, -1 if none did
+    static int first_match(std::string_view target_str) {
+        result res = match(target_str);
+        for (int i = 0; i < res.n_words; i++) {
+            if (res.words[i])
+                return i * 64 + __builtin_ctzll(res.words[i]);
+        }
+        return -1;
+    }
+};
+
+#endif
@@ -0,0 +1,456 @@
+#ifndef CTRE_SEARCH_H
+#define CTRE_SEARCH_H
+
+#include "match.h"
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// the match search found, position and length are only meaningful if matched
+struct search_result {
+    bool   matched  = false;
+    size_t position = 0;
+    size_t length   = 0;
+
+    explicit operator bool() const {
+        return matched;
+    }
+};
+
+//
+// Semantics
+//
+
+// Which match search_as reports. Unanchored searches take the leftmost
+// start in the input, anchored ones only matches that start at its
+// beginning. Of the matches from that start, the longest or the shortest
+// one is reported.
+template <bool ANCHORED, bool LONGEST>
+struct search_semantics {
+    static constexpr bool anchored = ANCHORED;
+    static constexpr bool longest  = LONGEST;
+};
+
+using leftmost_longest  = search_semantics<false, true>;
+using leftmost_shortest = search_semantics<false, false>;
+using anchored_longest  = search_semantics<true, true>;
+using anchored_shortest = search_semantics<true, false>;
+
+//
+// Acceleration
+//
+
+// DFA states that loop on all but a few bytes are skipped with memchr or
+// SIMD compares until one of those bytes shows up. The unanchored starting
+// state of a pattern like "GET /" is the typical case: only 'G' leaves it.
+struct accelerator {
+    int           n_bytes = -1;  // -1 if the state is not accelerated
+    unsigned char bytes[3]{};
+};
+
+// Keyed on the FA_minimize specialization rather than its result, and
+// every entry is assigned, so each pattern gets a table of its own.
+template <typename Min>
+struct DFA_accelerate {
+    static constexpr auto& DFA = Min::res;
+    static constexpr int   N   = DFA.state_count();
+
+    static constexpr array<accelerator, N> build() {
+        array<accelerator, N> res;
+
+        for (int s = 0; s < N; s++) {
+            res[s] = accelerator{};
+            if (s == DFA.dead_state)
+                continue;
+
+            accelerator acc;
+            acc.n_bytes = 0;
+            for (int c = 0; c < 256 && acc.n_bytes <= 3; c++) {
+                if (DFA.next(s, c) != s) {
+                    if (acc.n_bytes < 3)
+                        acc.bytes[acc.n_bytes] = static_cast<unsigned char>(c);
+                    acc.n_bytes++;
+                }
+            }
+            if (acc.n_bytes <= 3)
+                res[s] = acc;
+        }
+        return res;
+    }
+
+    static constexpr auto res = build();
+};
+
+// index of the first byte in [idx, size) that is one of acc.bytes, or size
+inline size_t skip(const accelerator& acc, const char* data, size_t idx, size_t size) {
+    if (acc.n_bytes == 0)
+        return size;
+
+    if (acc.n_bytes == 1) {
+        const void* found = std::memchr(data + idx, acc.bytes[0], size - idx);
+        return found ? static_cast<const char*>(found) - data : size;
+    }
+
+#ifdef __SSE2__
+    const __m128i b0 = _mm_set1_epi8(static_cast<char>(acc.bytes[0]));
+    const __m128i b1 = _mm_set1_epi8(static_cast<char>(acc.bytes[1]));
+    const __m128i b2 = _mm_set1_epi8(static_cast<char>(acc.bytes[acc.n_bytes == 3 ? 2 : 1]));
+    for (; idx + 16 <= size; idx += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + idx));
+        __m128i eq    = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, b0), _mm_cmpeq_epi8(chunk, b1)),
+                                  _mm_cmpeq_epi8(chunk, b2));
+        int     mask  = _mm_movemask_epi8(eq);
+        if (mask)
+            return idx + __builtin_ctz(mask);
+    }
+#endif
+
+    for (; idx < size; idx++) {
+        unsigned char c = static_cast<unsigned char>(data[idx]);
+        for (int i = 0; i < acc.n_bytes; i++) {
+            if (c == acc.bytes[i])
+                return idx;
+        }
+    }
+    return size;
+}
+
+//
+// Engines
+//
+
+// Where the leftmost match that ends at `end` starts: the furthest the
+// reversed pattern's DFA reaches backwards from end.
+template <int N_RS, int RS, typename Instrument = no_instrumentation>
+size_t match_start(const deterministic_automata<N_RS, RS>& rev, const char* data, size_t end, Instrument = {}) {
+    int    state = rev.start_state;
+    size_t start = end;
+    for (size_t idx = end; idx > 0 && !rev.is_decided(state);) {
+        idx--;
+        state = rev.next(state, static_cast<unsigned char>(data[idx]));
+        Instrument::bytes(1);
+        Instrument::states(1);
+        if (rev.is_final_state(state))
+            start = idx;
+    }
+
+    // every start further back matches too
+    if (state == rev.accepting_state && rev.is_final_state(state))
+        start = 0;
+    return start;
+}
+
+// Where the longest or the shortest match that starts at `start` ends, the
+// anchored DFA run from there. Returns size_t(-1) if none does.
+template <bool LONGEST, int N_S, int S, typename Instrument = no_instrumentation>
+size_t match_end(const deterministic_automata<N_S, S>& dfa,
+                 const char*                           data,
+                 size_t                                start,
+                 size_t                                size,
+                 Instrument = {}) {
+    int    state = dfa.start_state;
+    size_t end   = dfa.is_final_state(state) ? start : size_t(-1);
+
+    for (size_t idx = start; idx < size && !dfa.is_decided(state) && (LONGEST || end == size_t(-1));) {
+        state = dfa.next(state, static_cast<unsigned char>(data[idx]));
+        idx++;
+        Instrument::bytes(1);
+        Instrument::states(1);
+        if (dfa.is_final_state(state))
+            end = idx;
+    }
+
+    // every longer prefix matches too
+    if (LONGEST && state == dfa.accepting_state && dfa.is_final_state(state))
+        end = size;
+    return end;
+}
+
+// Forward leftmost-longest DFA to find where the match ends, then the
+// reversed pattern's DFA from there to find where it starts.
+// No match starts before `from`.
+template <int N_S, int FS, int N_RS, int RS, typename Instrument = no_instrumentation>
+search_result run_search(dfa_engine,
+                         const deterministic_automata<N_S, FS>&  fwd,
+                         const array<accelerator, N_S>&          acc,
+                         const deterministic_automata<N_RS, RS>& rev,
+                         std::string_view                        target_str,
+                         size_t                                  from,
+                         Instrument = {}) {
+    const char* data = target_str.data();
+    size_t      size = target_str.size();
+
+    int    state = fwd.start_state;
+    bool   found = fwd.is_final_state(state);
+    size_t end   = from;
+
+    for (size_t idx = from; idx < size;) {
+        const accelerator& a = acc[state];
+        if (a.n_bytes >= 0) {
+            // everything up to the next exit byte loops on state
+            size_t exit = skip(a, data, idx, size);
+            Instrument::bytes(exit - idx);
+            if (fwd.is_final_state(state) && exit > idx)
+                end = exit;
+            idx = exit;
+            if (idx == size)
+                break;
+        }
+
+        state = fwd.next(state, static_cast<unsigned char>(data[idx]));
+        idx++;
+        Instrument::bytes(1);
+        Instrument::states(1);
+
+        if (state == fwd.dead_state)
+            break;
+        if (fwd.is_final_state(state)) {
+            found = true;
+            end   = idx;
+        }
+    }
+
+    if (!found)
+        return {};
+
+    size_t start = match_start(rev, data, end, Instrument{});
+    return { true, start, end - start };
+}
+
+// pike VM whose threads remember where they started
+template <int N_S>
+struct search_thread_list : thread_list<N_S> {
+    array<size_t, N_S> starts;
+
+    template <int N_T>
+    void add(const compact_automata<N_S, N_T>& nfa, int state, size_t start) {
+        if (this->active.test(state))
+            return;
+        thread_list<N_S>::add(nfa, state);
+        starts[state] = start;
+    }
+};
+
+// Anchored searches only start the thread at `from`, shortest ones stop
+// stepping the leftmost start's threads once one of them matched.
+template <typename Semantics = leftmost_longest, int N_S, int N_T, typename Instrument = no_instrumentation>
+search_result run_search(pike_vm_engine,
+                         const compact_automata<N_S, N_T>& nfa,
+                         std::string_view                  target_str,
+                         size_t                            from,
+                         Instrument = {}) {
+    search_thread_list<N_S> lists[2];
+    int                     cur = 0;
+    search_result           res;
+
+    // Threads are kept in the order they started in, so the first thread to
+    // reach a final state decides the leftmost start. Returns true once the
+    // rest of the input can't change res: the oldest thread reached a state
+    // that accepts whatever follows.
+    auto check = [&](const search_thread_list<N_S>& list, size_t idx) {
+        for (int i = 0; i < list.size; i++) {
+            int state = list.states[i];
+            if (!nfa.is_final_state(state))
+                continue;
+
+            size_t start = list.starts[state];
+            if (Semantics::longest && i == 0 && nfa.is_accepting_state(state)) {
+                res = { true, start, target_str.size() - start };
+                return true;
+            }
+            if (!res.matched || start < res.position ||
+                (Semantics::longest && start == res.position && idx - start > res.length))
+                res = { true, start, idx - start };
+            return false;
+        }
+        return false;
+    };
+
+    lists[cur].add(nfa, 0, from);
+    if (check(lists[cur], from))
+        return res;
+
+    for (size_t idx = from; idx < target_str.size(); idx++) {
+        search_thread_list<N_S>& from = lists[cur];
+        search_thread_list<N_S>& to   = lists[cur ^ 1];
+
+        Instrument::bytes(1);
+        Instrument::states(from.size);
+
+        to.clear();
+        for (int i = 0; i < from.size; i++) {
+            int    state = from.states[i];
+            size_t start = from.starts[state];
+
+            // threads that start after a match can't be leftmost, and when
+            // shortest, the ones from its start can't improve on it
+            if (res.matched && (start > res.position || (!Semantics::longest && start == res.position)))
+                break;
+
+            for (int e = nfa.begin(state); e < nfa.end(state); e++) {
+                if (nfa.edges[e].match(static_cast<unsigned char>(target_str[idx])))
+                    to.add(nfa, nfa.edges[e].dst, start);
+            }
+        }
+
+        if (!Semantics::anchored && !res.matched)
+            to.add(nfa, 0, idx + 1);
+
+        if (check(to, idx + 1))
+            return res;
+        if (to.size == 0)
+            break;
+        cur ^= 1;
+    }
+
+    return res;
+}
+
+//
+// Compiled pattern
+//
+
+// The forward DFA starts a thread at every position and finds where the
+// leftmost match ends. The reversed NFA, built from the epsilon-free one
+// by turning every transition around and swapping the starting and final
+// states, matches the mirrored language; its DFA runs backwards from that
+// end to find the start. Both are linear, no position is scanned twice by
+// the same automaton.
+template <auto& pattern>
+struct compiled_search {
+    using C = compiled<pattern>;
+
+    static constexpr auto& reverse_nfa = FA_remove_epsilon<FA_reverse<C::remove_epsilon::res>::res>::res;
+
+    using forward    = FA_minimize<FA_determinize_leftmost<C::remove_epsilon::res>::res>;
+    using reverse    = FA_minimize<FA_determinize<reverse_nfa>::res>;
+    using accelerate = DFA_accelerate<forward>;
+
+    static constexpr bool dfa_fits =
+        FA_determinize_leftmost<C::remove_epsilon::res>::fits && FA_determinize<reverse_nfa>::fits;
+
+    // Anchored searches only need the anchored DFA match runs, shortest
+    // unanchored ones use it to find the first end from the leftmost start.
+    template <typename Semantics>
+    static constexpr bool dfa_fits_for =
+        Semantics::anchored ? C::determinize::fits : dfa_fits && (Semantics::longest || C::determinize::fits);
+};
+
+// Every match contains the required factor, and starts with the prefix,
+// so nothing before the first occurrence of the prefix can match. Returns
+// where the first match may start, or size_t(-1) if nothing can match.
+inline size_t search_from(const literal_info& literals, std::string_view target_str) {
+    size_t from = find_literal(literals.prefix, target_str.data(), 0, target_str.size());
+    if (from == target_str.size() && literals.prefix.size > 0)
+        return size_t(-1);
+    if (literals.factor.size > literals.prefix.size &&
+        find_literal(literals.factor, target_str.data(), from, target_str.size()) == target_str.size())
+        return size_t(-1);
+    return from;
+}
+
+// search_from for anchored searches: the prefix must be at the beginning.
+// The factor isn't looked for, an anchored match is usually decided within
+// a few bytes of a long input.
+inline size_t anchored_search_from(const literal_info& literals, std::string_view target_str) {
+    size_t n_prefix = literals.prefix.size;
+    if (target_str.size() < n_prefix || std::memcmp(target_str.data(), literals.prefix.data, n_prefix) != 0)
+        return size_t(-1);
+    return 0;
+}
+
+// Finds the match Semantics asks for in target_str. Only dfa_engine and
+// pike_vm_engine can search, auto_engine picks the DFA when the automata
+// the semantics need fit in the state budget. Instrument is a policy from
+// instrument.h.
+//
+// Unanchored searches run the forward DFA to the end of the leftmost-
+// longest match and the reversed one back to its start; the shortest match
+// from that start then ends where the anchored DFA first reaches a final
+// state. Anchored searches only run the anchored DFA from the beginning.
+template <auto&    pattern,
+          typename Semantics,
+          typename Engine     = auto_engine,
+          typename Instrument = no_instrumentation>
+search_result search_as(std::string_view target_str) {
+    using C = compiled<pattern>;
+    using S = compiled_search<pattern>;
+
+    constexpr bool fits    = S::template dfa_fits_for<Semantics>;
+    constexpr bool use_dfa = std::is_same_v<Engine, dfa_engine> || (std::is_same_v<Engine, auto_engine> && fits);
+
+    static_assert(std::is_same_v<Engine, auto_engine> || std::is_same_v<Engine, dfa_engine> ||
+                      std::is_same_v<Engine, pike_vm_engine>,
+                  "Engine can't search");
+
+    const char* data = target_str.data();
+    size_t      size = target_str.size();
+
+    size_t from = Semantics::anchored ? anchored_search_from(C::literals::res, target_str)
+                                      : search_from(C::literals::res, target_str);
+    if (from == size_t(-1)) {
+        Instrument::prefilter_hit();
+        return {};
+    }
+
+    if constexpr (use_dfa) {
+        static_assert(fits, "Too many DFA states, use another engine");
+        if constexpr (Semantics::anchored) {
+            size_t end = match_end<Semantics::longest>(C::dfa, data, 0, size, Instrument{});
+            if (end == size_t(-1))
+                return {};
+            return { true, 0, end };
+        } else {
+            search_result res = run_search(dfa_engine{}, S::forward::res, S::accelerate::res, S::reverse::res,
+                                           target_str, from, Instrument{});
+            // the shortest match from the leftmost start ends no later
+            if (!Semantics::longest && res)
+                res.length = match_end<false>(C::dfa, data, res.position, res.position + res.length, Instrument{}) -
+                             res.position;
+            return res;
+        }
+    } else {
+        return run_search<Semantics>(pike_vm_engine{}, C::compact, target_str, from, Instrument{});
+    }
+}
+
+template <auto&    pattern,
+          typename Semantics,
+          typename Engine     = auto_engine,
+          typename Instrument = no_instrumentation>
+search_result search_as(const char* data, size_t size) {
+    return search_as<pattern, Semantics, Engine, Instrument>(std::string_view(data, size));
+}
+
+// Length of the longest prefix of input that matches, size_t(-1) if none
+// does. The anchored DFA stops at the first byte after which no prefix can
+// match, or at a state that accepts whatever follows, so a tokenizer that
+// calls this at every token boundary reads about the bytes of the token.
+template <auto& pattern, typename Engine = auto_engine, typename Instrument = no_instrumentation>
+size_t match_prefix(std::string_view input) {
+    search_result res = search_as<pattern, anchored_longest, Engine, Instrument>(input);
+    return res ? res.length : size_t(-1);
+}
+
+template <auto& pattern, typename Engine = auto_engine, typename Instrument = no_instrumentation>
+size_t match_prefix(const char* data, size_t size) {
+    return match_prefix<pattern, Engine, Instrument>(std::string_view(data, size));
+}
+
+// Finds the leftmost-longest match in target_str, see search_as.
+template <auto& pattern, typename Engine = auto_engine, typename Instrument = no_instrumentation>
+search_result search(std::string_view target_str) {
+    return search_as<pattern, leftmost_longest, Engine, Instrument>(target_str);
+}
+
+template <auto& pattern, typename Engine = auto_engine, typename Instrument = no_instrumentation>
+search_result search(const char* data, size_t size) {
+    return search<pattern, Engine, Instrument>(std::string_view(data, size));
+}
+
+#endif
@@ -0,0 +1,214 @@
+#ifndef CTRE_STREAM_H
+#define CTRE_STREAM_H
+
+#include "match.h"
+#include "search.h"
+#include <cstddef>
+#include <string_view>
+#include <type_traits>
+
+//
+// Streaming
+//
+
+// Feed the input in chunks as it arrives, nothing is buffered. Only the
+// automaton state is carried from one chunk to the next: a DFA state number,
+// or the active Glushkov positions. Patterns that fit neither fall back to
+// the pike VM, whose state sets are sized from the NFA. Once rejected() or
+// accepted() turns true the rest of the input is not looked at.
+
+template <auto& pattern>
+class stream_matcher {
+  private:
+    using C = compiled<pattern>;
+
+    static constexpr bool use_bit_parallel = C::bit_parallel::fits;
+    static constexpr bool use_dfa          = !use_bit_parallel && C::determinize::fits;
+
+    struct bit_parallel_state {
+        uint64_t active  = 0;
+        bool     started = false;
+    };
+
+    struct pike_vm_state {
+        thread_list<C::nfa_state_count> lists[2];
+        int                             cur       = 0;
+        bool                            accepting = false;  // a thread is in an accepting state
+    };
+
+    using state_type = std::conditional_t<use_bit_parallel,
+                                          bit_parallel_state,
+                                          std::conditional_t<use_dfa, int, pike_vm_state>>;
+
+    state_type st;
+
+  public:
+    stream_matcher() {
+        reset();
+    }
+
+    void reset() {
+        st = state_type{};
+        if constexpr (use_dfa)
+            st = C::dfa.start_state;
+        else if constexpr (!use_bit_parallel) {
+            st.lists[0].add(C::compact, 0);
+            st.accepting = C::compact.is_accepting_state(0);
+        }
+    }
+
+    void feed(std::string_view chunk) {
+        const unsigned char* it  = reinterpret_cast<const unsigned char*>(chunk.data());
+        const unsigned char* end = it + chunk.size();
+
+        if constexpr (use_bit_parallel) {
+            const glushkov_automata& g = C::bit_parallel::res;
+            if (it != end && !st.started) {
+                st.active  = g.first & g.masks[*it++];
+                st.started = true;
+            }
+            for (; it != end && st.active != 0 && !(st.active & g.accepting); ++it) {
+                st.active = g.step(st.active, *it);
+            }
+        } else if constexpr (use_dfa) {
+            for (; it != end && !C::dfa.is_decided(st); ++it) {
+                st = C::dfa.next(st, *it);
+            }
+        } else {
+            for (; it != end && st.lists[st.cur].size > 0 && !st.accepting; ++it) {
+                auto& from = st.lists[st.cur];
+                auto& to   = st.lists[st.cur ^ 1];
+
+                to.clear();
+                for (int i = 0; i < from.size; i++) {
+                    int state = from.states[i];
+                    for (int e = C::compact.begin(state); e < C::compact.end(state); e++) {
+                        if (C::compact.edges[e].match(*it)) {
+                            to.add(C::compact, C::compact.edges[e].dst);
+                            st.accepting |= C::compact.is_accepting_state(C::compact.edges[e].dst);
+                        }
+                    }
+                }
+                st.cur ^= 1;
+            }
+        }
+    }
+
+    void feed(const char* data, size_t size) {
+        feed(std::string_view(data, size));
+    }
+
+    // true if no continuation of the input fed so far can match any more,
+    // so the caller can stop feeding
+    bool rejected() const {
+        if constexpr (use_bit_parallel)
+            return st.started && st.active == 0;
+        else if constexpr (use_dfa)
+            return st == C::dfa.dead_state;
+        else
+            return st.lists[st.cur].size == 0;
+    }
+
+    // true if every continuation of the input fed so far matches
+    bool accepted() const {
+        if constexpr (use_bit_parallel)
+            return (st.active & C::bit_parallel::res.accepting) != 0;
+        else if constexpr (use_dfa)
+            return st == C::dfa.accepting_state && C::dfa.is_final_state(st);
+        else
+            return st.accepting;
+    }
+
+    // whether everything fed since the last reset matches the pattern
+    bool finish() const {
+        if constexpr (use_bit_parallel) {
+            const glushkov_automata& g = C::bit_parallel::res;
+            return st.started ? (st.active & g.last) != 0 : g.nullable;
+        } else if constexpr (use_dfa) {
+            return C::dfa.is_final_state(st);
+        } else {
+            const auto& list = st.lists[st.cur];
+            for (int i = 0; i < list.size; i++) {
+                if (C::compact.is_final_state(list.states[i]))
+                    return true;
+            }
+            return false;
+        }
+    }
+};
+
+// Unanchored counterpart of stream_matcher, runs the leftmost-longest
+// forward DFA of search. found() turns true as soon as a match has been
+// seen. Where the match starts is not known without the data, the end is
+// final once done() or after finish().
+template <auto& pattern>
+class stream_searcher {
+  private:
+    using S = compiled_search<pattern>;
+
+    static_assert(FA_determinize_leftmost<compiled<pattern>::remove_epsilon::res>::fits,
+                  "Too many DFA states for streaming search");
+
+    static constexpr auto& dfa = S::forward::res;
+
+    int    state    = dfa.start_state;
+    bool   is_found = dfa.is_final_state(dfa.start_state);
+    size_t offset   = 0;  // bytes fed so far
+    size_t end      = 0;
+
+  public:
+    void reset() {
+        *this = stream_searcher{};
+    }
+
+    void feed(std::string_view chunk) {
+        const char* data = chunk.data();
+        size_t      size = chunk.size();
+
+        for (size_t idx = 0; idx < size && state != dfa.dead_state;) {
+            const accelerator& a = S::accelerate::res[state];
+            if (a.n_bytes >= 0) {
+                // the match only grows over the skipped bytes in a final state
+                size_t exit = skip(a, data, idx, size);
+                if (dfa.is_final_state(state) && exit > idx)
+                    end = offset + exit;
+                idx = exit;
+                if (idx == size)
+                    break;
+            }
+
+            state = dfa.next(state, static_cast<unsigned char>(data[idx]));
+            idx++;
+
+            if (dfa.is_final_state(state)) {
+                is_found = true;
+                end      = offset + idx;
+            }
+        }
+        offset += size;
+    }
+
+    void feed(const char* data, size_t size) {
+        feed(std::string_view(data, size));
+    }
+
+    bool found() const {
+        return is_found;
+    }
+
+    // the match can't grow any more
+    bool done() const {
+        return state == dfa.dead_state;
+    }
+
+    // whether the input contained a match, match_end() is where it ended
+    bool finish() const {
+        return is_found;
+    }
+
+    size_t match_end() const {
+        return end;
+    }
+};
+
+#endif
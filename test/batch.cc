@@ -0,0 +1,74 @@
+// match_batch against the oracle, over batches with inputs of very
+// different lengths so lanes retire and refill at different times. Built a
+// second time with -mavx2 as batch_avx2 to cover the gather loop.
+
+#include "test.h"
+#include <batch.h>
+#include <memory>
+#include <vector>
+
+static constexpr fixed_string loop("a(b|c)*d");
+static constexpr fixed_string third_last("(a|b)*a(a|b)(a|b)");
+static constexpr fixed_string classes("[a-c]+x?[0-9]*");
+static constexpr fixed_string blow_up("(a|b)*a(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)");
+
+template <auto& pattern>
+void check_batch(std::string_view alphabet) {
+    std::mt19937 rng(12345);
+
+    for (size_t count = 0; count < 40; count++) {
+        std::vector<std::string> inputs(count);
+        for (std::string& s : inputs) {
+            // mostly short inputs, some empty and a few long ones
+            size_t size = rng() % 4 == 0 ? rng() % 200 : rng() % 8;
+            for (size_t i = 0; i < size; i++) {
+                s += alphabet[rng() % alphabet.size()];
+            }
+        }
+
+        std::unique_ptr<bool[]> results(new bool[count + 1]);
+        results[count] = true;
+        match_batch<pattern>(inputs.data(), count, results.get());
+        for (size_t i = 0; i < count; i++) {
+            CHECK_ON(inputs[i], results[i] == oracle_match<pattern>(inputs[i]));
+        }
+        CHECK(results[count]);
+
+        // lane counts other than the default
+        if constexpr (compiled<pattern>::determinize::fits) {
+            std::unique_ptr<bool[]> one(new bool[count]), three(new bool[count]);
+            run_batch<1>(compiled<pattern>::dfa, inputs.data(), count, one.get());
+            run_batch<3>(compiled<pattern>::dfa, inputs.data(), count, three.get());
+            for (size_t i = 0; i < count; i++) {
+                CHECK_ON(inputs[i], one[i] == results[i] && three[i] == results[i]);
+            }
+        }
+    }
+}
+
+int main() {
+#ifdef __AVX2__
+    if (!__builtin_cpu_supports("avx2")) {
+        printf("batch_avx2: skipped, no AVX2\n");
+        return 0;
+    }
+#endif
+
+    check_batch<loop>("abcd");
+    check_batch<third_last>("ab");
+    check_batch<classes>("abx09");
+    // over the DFA budget, one match call per input
+    check_batch<blow_up>("ab");
+
+    // string_views work as well as strings
+    std::string_view views[] = { "ad", "abcd", "", "abce" };
+    bool             results[4];
+    match_batch<loop>(views, 4, results);
+    CHECK(results[0] && results[1] && !results[2] && !results[3]);
+
+#ifdef __AVX2__
+    return test_result("batch_avx2");
+#else
+    return test_result("batch");
+#endif
+}
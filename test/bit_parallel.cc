@@ -0,0 +1,74 @@
+// The Glushkov automaton run by bit_parallel_engine, up to 64 positions.
+
+#include "test.h"
+#include <match.h>
+
+static constexpr fixed_string literal("abc");
+static constexpr fixed_string loop("a(b|c)*d");
+static constexpr fixed_string nested("((a|b)*c(d|e)*)*f");
+static constexpr fixed_string star_star("(a*)*b");
+static constexpr fixed_string optional("a?b?(c|d?)*");
+static constexpr fixed_string classes("[a-c]+[^ab]?");
+static constexpr fixed_string counted("(ab|c){2,3}d");
+static constexpr fixed_string prefix("ab(a|b|c|d|e|f)*");
+static constexpr fixed_string third_last("(a|b)*a(a|b)(a|b)");
+
+// 64 and 65 positions, the last ones loop back to the first
+static constexpr fixed_string full("(abcdefgh"
+                                   "abcdefgh"
+                                   "abcdefgh"
+                                   "abcdefgh"
+                                   "abcdefgh"
+                                   "abcdefgh"
+                                   "abcdefgh"
+                                   "abcdef(h|a))*");
+static constexpr fixed_string over("(abcdefgh"
+                                   "abcdefgh"
+                                   "abcdefgh"
+                                   "abcdefgh"
+                                   "abcdefgh"
+                                   "abcdefgh"
+                                   "abcdefgh"
+                                   "abcdefgh|a)*");
+
+template <auto& pattern>
+void check_bit_parallel(std::string_view alphabet) {
+    static_assert(compiled<pattern>::bit_parallel::fits);
+
+    for_inputs(alphabet, 6, 40, 500, [](const std::string& s) {
+        CHECK_ON(s, (match<pattern, bit_parallel_engine>(s) == oracle_match<pattern>(s)));
+    });
+}
+
+int main() {
+    check_bit_parallel<literal>("abc");
+    check_bit_parallel<loop>("abcd");
+    check_bit_parallel<nested>("abcdef");
+    check_bit_parallel<star_star>("ab");
+    check_bit_parallel<optional>("abcd");
+    check_bit_parallel<classes>("abcd");
+    check_bit_parallel<counted>("abcd");
+    check_bit_parallel<prefix>("abcg");
+    check_bit_parallel<third_last>("ab");
+
+    std::string block = "abcdefghabcdefghabcdefghabcdefghabcdefghabcdefghabcdefghabcdefh";
+    std::string other = block.substr(0, 62) + "a";
+    CHECK((match<full, bit_parallel_engine>(block + other + block)));
+    CHECK((!match<full, bit_parallel_engine>(block + "a")));
+    CHECK((!match<full, bit_parallel_engine>(block.substr(0, 62))));
+    CHECK((match<over>(block.substr(0, 56) + "abcdefgh" + "a")));
+
+    static_assert(compiled<full>::bit_parallel::position_count == 64);
+    static_assert(compiled<full>::bit_parallel::fits);
+    static_assert(compiled<over>::bit_parallel::position_count == 65);
+    static_assert(!compiled<over>::bit_parallel::fits);
+    static_assert(std::is_same_v<compiled<full>::engine, bit_parallel_engine>);
+    static_assert(!std::is_same_v<compiled<over>::engine, bit_parallel_engine>);
+
+    // one position per character or class, x+ is x x* and x{2,3} has three
+    // copies of x
+    static_assert(compiled<classes>::bit_parallel::position_count == 3);
+    static_assert(compiled<counted>::bit_parallel::position_count == 10);
+
+    return test_result("bit_parallel");
+}
@@ -0,0 +1,69 @@
+// match_result's groups against std::regex's, on both front ends. Groups
+// std::regex leaves unmatched must have a null data().
+
+#include "test.h"
+#include <capture.h>
+
+static constexpr fixed_string kv("(a|b)+=(c|d)*");
+static constexpr fixed_string priority("(a|ab)(c|bcd)(d*)");
+static constexpr fixed_string optional("(a?)(ab)?(b?)");
+static constexpr fixed_string nested("((a)|b)*");
+static constexpr fixed_string star_star("(a*)*b");
+static constexpr fixed_string plus_opt("(a*)+b?");
+static constexpr fixed_string alter_star("(a|b*)*");
+static constexpr fixed_string deep("((a*)b?)*(c)?");
+static constexpr fixed_string three("(a?){3}");
+static constexpr fixed_string counted("(a|bc){1,3}(c?){0,2}");
+static constexpr fixed_string unbounded("(a?b?){2,}");
+
+// over 48 characters, read by the flat parser
+static constexpr fixed_string flat("((a|b)*c)?(d|e)+((a|b)?(c|d)?){0,2}x*(y|z)?(aaaa|bb)?(a*)*");
+
+template <auto& pattern>
+void check_groups(std::string_view alphabet, size_t max_size = 8) {
+    for_inputs(alphabet, 5, max_size, 300, [](std::string_view s) {
+        std::match_results<std::string_view::const_iterator> want;
+        bool matched = std::regex_match(s.begin(), s.end(), want, oracle<pattern>());
+
+        auto res = match_result<pattern>(s);
+        CHECK_ON(s, bool(res) == matched);
+        if (!res || !matched)
+            return;
+
+        CHECK_ON(s, res[0] == s);
+        for (int i = 1; i < res.size(); i++) {
+            if (!want[i].matched) {
+                CHECK_ON(s, res[i].data() == nullptr);
+                continue;
+            }
+            size_t start = want[i].first - s.begin();
+            CHECK_ON(s, res[i].data() == s.data() + start && res[i].size() == size_t(want[i].length()));
+        }
+    });
+}
+
+int main() {
+    static_assert(compiled<flat>::flat);
+
+    check_groups<kv>("abcd=");
+    check_groups<priority>("abcd");
+    check_groups<optional>("ab");
+    check_groups<nested>("ab");
+    check_groups<star_star>("ab");
+    check_groups<plus_opt>("ab");
+    check_groups<alter_star>("ab");
+    check_groups<deep>("abc");
+    check_groups<three>("ab");
+    check_groups<counted>("abc");
+    check_groups<unbounded>("ab");
+    check_groups<flat>("abcdexyz", 6);
+
+    // a repeated group holds its last iteration
+    CHECK(match_result<kv>("abba=cdc").get<1>() == "a");
+
+    // an empty iteration ends the loop and its groups are its own
+    CHECK(match_result<star_star>("ab")[1] == "");
+    CHECK(match_result<three>("a")[1] == "");
+
+    return test_result("capture");
+}
@@ -0,0 +1,81 @@
+// Character classes, ranges, escapes and '.', and the byte classes that
+// compress the DFA's alphabet.
+
+#include "test.h"
+#include <match.h>
+
+static constexpr fixed_string ranges("[a-c][x-z0-2]*");
+static constexpr fixed_string negated("[^a-c\n]+a");
+static constexpr fixed_string dashes("[-a][a-]");
+static constexpr fixed_string escapes("\\d+\\.\\w*\\s?");
+static constexpr fixed_string in_class("[\\d_.]+x");
+static constexpr fixed_string negated_escapes("\\D\\W\\S");
+static constexpr fixed_string dot("a.b");
+static constexpr fixed_string punctuation("\\(\\*\\)\\[\\]");
+
+// over the flat parser's threshold
+static constexpr fixed_string long_classes("[a-c]+[^a-c]*(\\d|[x-z])+\\.?[a-c][a-c][a-c][a-c][a-c][a-c][a-c]*");
+
+template <auto& pattern>
+void check_classes(std::string_view alphabet) {
+    for_inputs(alphabet, 4, 20, 500, [](std::string_view s) {
+        CHECK_ON(s, match<pattern>(s) == oracle_match<pattern>(s));
+        CHECK_ON(s, (match<pattern, pike_vm_engine>(s) == oracle_match<pattern>(s)));
+    });
+}
+
+// bytes of a class are interchangeable: every state goes to the same state
+// on all of them
+template <auto& pattern>
+bool classes_are_sound() {
+    constexpr auto& dfa = compiled<pattern>::dfa;
+    if (dfa.classes.stride() < dfa.class_count())
+        return false;
+    for (int s = 0; s < dfa.state_count(); s++) {
+        int first[256];
+        for (int k = 0; k < 256; k++) {
+            first[k] = -1;
+        }
+        for (int c = 0; c < 256; c++) {
+            int k = dfa.classes.of[c];
+            if (first[k] < 0)
+                first[k] = dfa.next(s, c);
+            else if (first[k] != dfa.next(s, c))
+                return false;
+        }
+    }
+    return true;
+}
+
+int main() {
+    check_classes<ranges>("abxz03");
+    check_classes<negated>("abdz\n");
+    check_classes<dashes>("-ab");
+    check_classes<escapes>("07.a_ \n");
+    check_classes<in_class>("0_.xa");
+    check_classes<negated_escapes>("0a_ -\t");
+    check_classes<dot>("ab\n");
+    check_classes<punctuation>("()*[]");
+    check_classes<long_classes>("ab0x.");
+
+    CHECK(classes_are_sound<ranges>());
+    CHECK(classes_are_sound<negated>());
+    CHECK(classes_are_sound<escapes>());
+    CHECK(classes_are_sound<dot>());
+    CHECK(classes_are_sound<long_classes>());
+
+    // a class per range and per gap between ranges: [0-2], [a-c], [x-z] and
+    // the four gaps around them
+    static_assert(compiled<ranges>::dfa.class_count() == 7);
+    static_assert(compiled<ranges>::stats.byte_classes == 7);
+    // '\n', a, b and the three gaps
+    static_assert(compiled<dot>::dfa.class_count() == 6);
+
+    // bytes above 0x7f are matched by negated classes and '.' only
+    CHECK((match<dot>("a\xff" "b")));
+    CHECK((match<negated>("\x80\xff" "a")));
+    CHECK((!match<ranges>("\xe1")));
+    CHECK((!match<dot>("a\nb")));
+
+    return test_result("classes");
+}
@@ -0,0 +1,75 @@
+// codegen_engine runs the DFA compiled into code, it answers what the
+// table-driven DFA answers.
+
+#include "test.h"
+#include <match.h>
+
+static constexpr fixed_string literal("abc");
+static constexpr fixed_string loop("a(b|c)*d");
+static constexpr fixed_string nested("((a|b)*c(d|e)*)*f");
+static constexpr fixed_string third_last("(a|b)*a(a|b)(a|b)");
+static constexpr fixed_string classes("[^a]+[b-y]?.z");
+static constexpr fixed_string prefix("ab(.|\n)*");
+
+// the ranges cover every transition that doesn't go to the dead state
+template <auto& DFA>
+bool same_ranges() {
+    constexpr auto& t = DFA_ranges<DFA>::res;
+    for (int s = 0; s < DFA.state_count(); s++) {
+        int expected[256];
+        for (int c = 0; c < 256; c++) {
+            expected[c] = DFA.dead_state;
+        }
+        for (int i = t.offset[s]; i < t.offset[s + 1]; i++) {
+            for (int c = t.ranges[i].lo; c <= t.ranges[i].hi; c++) {
+                expected[c] = t.ranges[i].dst;
+            }
+        }
+        for (int c = 0; c < 256; c++) {
+            if (DFA.next(s, c) != expected[c])
+                return false;
+        }
+    }
+    return true;
+}
+
+template <auto& pattern>
+void check_codegen(std::string_view alphabet) {
+    CHECK(same_ranges<compiled<pattern>::dfa>());
+
+    for_inputs(alphabet, 6, 40, 500, [](std::string_view s) {
+        CHECK_ON(s, (match<pattern, codegen_engine>(s) == oracle_match<pattern>(s)));
+    });
+
+    // any byte, the table-driven DFA is the reference
+    std::mt19937 rng(12345);
+    std::string  s;
+    for (int i = 0; i < 500; i++) {
+        s.resize(rng() % 40);
+        for (char& c : s) {
+            c = rng() % 4 ? alphabet[rng() % alphabet.size()] : static_cast<char>(rng());
+        }
+        CHECK_ON(s, (match<pattern, codegen_engine>(s) == match<pattern, dfa_engine>(s)));
+    }
+}
+
+int main() {
+    check_codegen<literal>("abc");
+    check_codegen<loop>("abcd");
+    check_codegen<nested>("abcdef");
+    check_codegen<third_last>("ab");
+    check_codegen<classes>("abyz");
+    check_codegen<prefix>("ab\n");
+
+    // stops at the first byte that decides, a long tail costs nothing
+    using I = count_instrumentation<>;
+
+    std::string long_tail = "ab" + std::string(1 << 20, 'x');
+    CHECK((match<prefix, codegen_engine, I>(long_tail.begin(), long_tail.end())));
+    CHECK(I::counts.bytes_scanned == 2);
+    I::reset();
+    CHECK((!match<loop, codegen_engine, I>(long_tail.begin(), long_tail.end())));
+    CHECK(I::counts.bytes_scanned == 3);
+
+    return test_result("codegen");
+}
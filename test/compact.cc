@@ -0,0 +1,121 @@
+// FA_compact: the NFA engines' layout holds the live part of the
+// epsilon-free NFA in the narrowest types that fit.
+
+#include "test.h"
+#include <match.h>
+
+static constexpr fixed_string loop("a(b|c)*d");
+static constexpr fixed_string nested("((a|b)*c(d|e)*)*f");
+static constexpr fixed_string alternation("ab|ac(x|y)");
+static constexpr fixed_string prefix_any("ab(.|\n)*");
+static constexpr fixed_string a_any_b("a.*b");
+static constexpr fixed_string wide("(ab|cd){150}");
+
+// the compact edges are the NFA's transitions into states that reach a
+// final state, in the same order, and the final states are the same
+template <auto& pattern>
+bool same_automaton() {
+    constexpr auto& nfa     = compiled<pattern>::nfa;
+    constexpr auto& compact = compiled<pattern>::compact;
+    constexpr auto& live    = FA_compact<nfa>::live;
+
+    int e = 0;
+    for (const transition& t : nfa.transitions) {
+        if (!live.test(t.dst))
+            continue;
+        if (e < compact.begin(t.src) || e >= compact.end(t.src))
+            return false;
+        const auto& edge = compact.edges[e++];
+        if (edge.lo != t.lo || edge.hi != t.hi || edge.dst != t.dst)
+            return false;
+    }
+    if (e != compact.size_transition())
+        return false;
+
+    for (int s = 0; s < nfa.state_count(); s++) {
+        bool is_final = false;
+        for (int fs : nfa.final_states) {
+            is_final = is_final || fs == s;
+        }
+        if (compact.is_final_state(s) != is_final)
+            return false;
+    }
+    return true;
+}
+
+// accepting states are final and stay among accepting states on every byte
+template <auto& pattern>
+bool accepting_states_accept() {
+    constexpr auto& compact = compiled<pattern>::compact;
+    for (int s = 0; s < compact.state_count(); s++) {
+        if (!compact.is_accepting_state(s))
+            continue;
+        if (!compact.is_final_state(s))
+            return false;
+        for (int c = 0; c < 256; c++) {
+            bool stays = false;
+            for (int e = compact.begin(s); e < compact.end(s); e++) {
+                stays = stays || (compact.edges[e].match(c) && compact.is_accepting_state(compact.edges[e].dst));
+            }
+            if (!stays)
+                return false;
+        }
+    }
+    return true;
+}
+
+template <auto& pattern>
+bool has_accepting_state() {
+    constexpr auto& compact = compiled<pattern>::compact;
+    for (int s = 0; s < compact.state_count(); s++) {
+        if (compact.is_accepting_state(s))
+            return true;
+    }
+    return false;
+}
+
+template <auto& pattern>
+void check_compact() {
+    CHECK(same_automaton<pattern>());
+    CHECK(accepting_states_accept<pattern>());
+}
+
+int main() {
+    static_assert(std::is_same_v<uint_for<255>, uint8_t>);
+    static_assert(std::is_same_v<uint_for<256>, uint16_t>);
+    static_assert(std::is_same_v<uint_for<65535>, uint16_t>);
+    static_assert(std::is_same_v<uint_for<65536>, uint32_t>);
+
+    check_compact<loop>();
+    check_compact<nested>();
+    check_compact<alternation>();
+    check_compact<prefix_any>();
+    check_compact<a_any_b>();
+    check_compact<wide>();
+
+    // small patterns take 3 bytes per edge, larger ones 4
+    using small = std::decay_t<decltype(compiled<loop>::compact)>;
+    static_assert(std::is_same_v<small::state_id, uint8_t> && sizeof(small::edge) == 3);
+
+    using large = std::decay_t<decltype(compiled<wide>::compact)>;
+    static_assert(compiled<wide>::nfa_state_count > 255);
+    static_assert(std::is_same_v<large::state_id, uint16_t> && sizeof(large::edge) == 4);
+
+    CHECK(has_accepting_state<prefix_any>());
+    CHECK(!has_accepting_state<a_any_b>());
+
+    // engines on the compact layout still match
+    for_inputs("abcdef", 5, 400, 200, [](std::string_view s) {
+        CHECK_ON(s, (match<nested, pike_vm_engine>(s) == oracle_match<nested>(s)));
+        CHECK_ON(s, (match<nested, backtrack_engine>(s) == oracle_match<nested>(s)));
+    });
+
+    std::string pairs;
+    for (int i = 0; i < 150; i++) {
+        pairs += i % 3 ? "ab" : "cd";
+    }
+    CHECK((match<wide, pike_vm_engine>(pairs) && match<wide, backtrack_engine>(pairs)));
+    CHECK((!match<wide, pike_vm_engine>(pairs + "ab")));
+
+    return test_result("compact");
+}
@@ -0,0 +1,112 @@
+// The constexpr building blocks FA construction relies on: array::sorted,
+// the cached state count and the sorted transitions engines search.
+
+#include "test.h"
+#include <algorithm>
+#include <match.h>
+#include <vector>
+
+static constexpr fixed_string nested("((a|b)*c(d|e)*)*f");
+static constexpr fixed_string alternation("abc|abd|b|cde|e");
+static constexpr fixed_string counted("(a|b?){2,4}c");
+static constexpr fixed_string keywords("(if|else|while|for|return|break|continue|switch|case|default)");
+
+struct keyed {
+    int key;
+    int idx;
+};
+
+constexpr bool by_key(const keyed& lhs, const keyed& rhs) {
+    return lhs.key < rhs.key;
+}
+
+// equal keys keep their order
+template <int N>
+void check_sorted(std::mt19937& rng) {
+    array<keyed, N> a;
+    for (int i = 0; i < N; i++) {
+        a[i] = { static_cast<int>(rng() % 8), i };
+    }
+
+    std::vector<keyed> expected(a.begin(), a.end());
+    std::stable_sort(expected.begin(), expected.end(), by_key);
+
+    array<keyed, N> res = a.sorted(by_key);
+    for (int i = 0; i < N; i++) {
+        CHECK(res[i].key == expected[i].key && res[i].idx == expected[i].idx);
+    }
+}
+
+constexpr bool sorts_at_compile_time() {
+    array<keyed, 5> a;
+    a[0] = { 3, 0 };
+    a[1] = { 1, 1 };
+    a[2] = { 3, 2 };
+    a[3] = { 0, 3 };
+    a[4] = { 1, 4 };
+    auto res = a.sorted(by_key);
+    return res[0].idx == 3 && res[1].idx == 1 && res[2].idx == 4 && res[3].idx == 0 && res[4].idx == 2;
+}
+
+// the count add_* keep is the highest state mentioned + 1
+template <typename FA>
+constexpr int scanned_state_count(const FA& fa) {
+    int res = 0;
+    for (const transition& t : fa.transitions) {
+        res = std::max({ res, t.src + 1, t.dst + 1 });
+    }
+    for (int fs : fa.final_states) {
+        res = std::max(res, fs + 1);
+    }
+    return res;
+}
+
+// sorted by (src, dst) and lower_idx_in_trans finds every state's first
+// transition
+template <typename FA>
+bool is_searchable(const FA& fa) {
+    for (int i = 1; i < fa.size_transition(); i++) {
+        const transition &a = fa.transitions[i - 1], &b = fa.transitions[i];
+        if (a.src > b.src || (a.src == b.src && a.dst > b.dst))
+            return false;
+    }
+    for (int i = 0; i < fa.size_transition(); i++) {
+        int src = fa.transitions[i].src;
+        if ((i == 0 || fa.transitions[i - 1].src != src) && fa.lower_idx_in_trans(src) != i)
+            return false;
+    }
+    return std::is_sorted(fa.final_states.begin(), fa.final_states.end());
+}
+
+template <auto& pattern>
+void check_construction() {
+    using C = compiled<pattern>;
+    static_assert(C::thompson_nfa.state_count() == scanned_state_count(C::thompson_nfa));
+    static_assert(C::nfa.state_count() == scanned_state_count(C::nfa));
+
+    CHECK(is_searchable(C::nfa));
+}
+
+int main() {
+    static_assert(sorts_at_compile_time());
+
+    std::mt19937 rng(12345);
+    for (int i = 0; i < 20; i++) {
+        check_sorted<1>(rng);
+        check_sorted<2>(rng);
+        check_sorted<7>(rng);
+        check_sorted<64>(rng);
+        check_sorted<100>(rng);
+    }
+
+    check_construction<nested>();
+    check_construction<alternation>();
+    check_construction<counted>();
+    check_construction<keywords>();
+
+    using U = FA_union<compiled<nested>::thompson_nfa, compiled<alternation>::thompson_nfa>;
+    CHECK(is_searchable(U::res));
+    static_assert(U::res.state_count() == scanned_state_count(U::res));
+
+    return test_result("construction");
+}
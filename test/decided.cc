@@ -0,0 +1,68 @@
+// Engines stop reading once the answer can't change: at the dead state, or
+// at a state that accepts whatever follows. Counts the bytes they read.
+
+#include "test.h"
+
+static constexpr fixed_string a_any_b("a.*b");
+static constexpr fixed_string prefix_any("ab(.|\n)*");
+static constexpr fixed_string token("[a-z]+|[0-9]+");
+
+// more DFA states than FA_determinize may build, run by the lazy DFA. The
+// second branch accepts everything after its c.
+static constexpr fixed_string lazy("(a|b)*a(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)|(a|b)*c(.|\n)*");
+
+template <auto& pattern>
+struct tag {};
+
+// iterators rather than pointers, the literal prefilter reads no bytes
+template <auto& pattern, typename Engine>
+size_t bytes_read(const std::string& s) {
+    using I = count_instrumentation<tag<pattern>>;
+    I::reset();
+    match<pattern, Engine, I>(s.begin(), s.end());
+    return I::counts.bytes_scanned;
+}
+
+template <auto& pattern>
+void check_prefix(std::string_view alphabet) {
+    for_inputs(alphabet, 5, 20, 400, [](std::string_view s) {
+        search_result want = oracle_search<pattern>(s, true, true);
+        CHECK_ON(s, match_prefix<pattern>(s) == (want ? want.length : size_t(-1)));
+    });
+}
+
+int main() {
+    CHECK((bytes_read<prefix_any, dfa_engine>("abxxxxxxxx") == 2));
+    CHECK((bytes_read<prefix_any, dfa_engine>("bxxxxxxxxx") == 1));
+    CHECK((bytes_read<lazy, lazy_dfa_engine>("ccccccccccc") == 1));
+    CHECK(match<lazy>("abababc\nx"));
+
+    // the lazy DFA must stop at a state that accepts everything even when
+    // reaching it flushed the cache: fill the cache with states of a and b,
+    // each longer prefix of s adds at most one
+    using L = lazy_dfa<compiled<lazy>::compact>;
+    auto& cache = L::local_cache();
+    cache.flush();
+    std::mt19937 rng(3);
+    std::string  s;
+    for (int k = 0; k < 4000; k++) {
+        s += "ab"[rng() % 2];
+    }
+    for (size_t i = 1; i <= s.size() && cache.size < L::CAPACITY; i++) {
+        match<lazy, lazy_dfa_engine>(s.begin(), s.begin() + i);
+    }
+    CHECK(cache.size == L::CAPACITY);
+    cache.bytes_since_flush = size_t(lazy_dfa_min_bytes_per_state) * L::CAPACITY;
+    CHECK((bytes_read<lazy, lazy_dfa_engine>("cabab") == 1));
+    CHECK(cache.size < L::CAPACITY);
+
+    check_prefix<a_any_b>("ab\n");
+    check_prefix<prefix_any>("abx");
+    check_prefix<token>("a1 ");
+
+    // longest prefixes over accepting states read to the end
+    CHECK(match_prefix<prefix_any>("abcdef") == 6);
+    CHECK(match_prefix<token>("abc123") == 3);
+
+    return test_result("decided");
+}
@@ -0,0 +1,43 @@
+// The DFA built at compile time by subset construction, run by dfa_engine.
+
+#include "test.h"
+#include <match.h>
+
+static constexpr fixed_string literal("abc");
+static constexpr fixed_string alternation("a(ab|cd)+");
+static constexpr fixed_string nested("((a|b)*c(d|e)*)*f");
+static constexpr fixed_string star_star("(a*)*b");
+static constexpr fixed_string empty_match("a*");
+static constexpr fixed_string third_last("(a|b)*a(a|b)(a|b)");
+static constexpr fixed_string blow_up("(a|b)*a(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)");
+
+template <auto& pattern>
+void check_dfa(std::string_view alphabet) {
+    static_assert(compiled<pattern>::determinize::fits);
+
+    for_inputs(alphabet, 6, 40, 500, [](const std::string& s) {
+        CHECK_ON(s, (match<pattern, dfa_engine>(s) == oracle_match<pattern>(s)));
+    });
+}
+
+int main() {
+    check_dfa<literal>("abc");
+    check_dfa<alternation>("abcd");
+    check_dfa<nested>("abcdef");
+    check_dfa<star_star>("ab");
+    check_dfa<empty_match>("ab");
+    check_dfa<third_last>("ab");
+
+    // the starting state is 1, the dead state 0 has no way out
+    constexpr auto& dfa = compiled<literal>::dfa;
+    static_assert(dfa.next(dfa.start_state, 'a') != dfa.dead_state);
+    static_assert(dfa.next(dfa.start_state, 'b') == dfa.dead_state);
+    static_assert(dfa.next(dfa.dead_state, 'a') == dfa.dead_state);
+
+    // (a|b)*a(a|b){n} needs 2^(n+1) states plus the dead one, n = 8 is over
+    // the budget and left to the other engines
+    static_assert(compiled<third_last>::minimize::state_count == 9);
+    static_assert(!compiled<blow_up>::determinize::fits);
+
+    return test_result("dfa");
+}
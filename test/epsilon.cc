@@ -0,0 +1,104 @@
+// FA_remove_epsilon: the epsilon-free NFA accepts what the Thompson NFA
+// accepts, without epsilon transitions and with fewer states.
+
+#include "test.h"
+#include <match.h>
+#include <vector>
+
+static constexpr fixed_string literal("abc");
+static constexpr fixed_string alternation("a(ab|cd)+");
+static constexpr fixed_string nested("((a|b)*c(d|e)*)*f");
+static constexpr fixed_string star_star("(a*)*b");
+static constexpr fixed_string optional("a?b?(c|d?)*");
+static constexpr fixed_string counted("(a|b?){2,4}c");
+
+// the reference simulation, follows epsilon transitions at every step
+template <typename FA>
+bool simulate(const FA& fa, std::string_view s) {
+    std::vector<bool> cur(fa.state_count()), next(fa.state_count());
+
+    auto close = [&](std::vector<bool>& set) {
+        for (bool changed = true; changed;) {
+            changed = false;
+            for (const transition& t : fa.transitions) {
+                if (t.is_epsilon && set[t.src] && !set[t.dst])
+                    set[t.dst] = changed = true;
+            }
+        }
+    };
+
+    cur[0] = true;
+    close(cur);
+    for (char c : s) {
+        next.assign(next.size(), false);
+        for (const transition& t : fa.transitions) {
+            if (!t.is_epsilon && cur[t.src] && t.match(c))
+                next[t.dst] = true;
+        }
+        close(next);
+        cur.swap(next);
+    }
+
+    for (int fs : fa.final_states) {
+        if (cur[fs])
+            return true;
+    }
+    return false;
+}
+
+template <typename FA>
+constexpr bool has_epsilon(const FA& fa) {
+    for (const transition& t : fa.transitions) {
+        if (t.is_epsilon)
+            return true;
+    }
+    return false;
+}
+
+// every state is reachable from state 0
+template <typename FA>
+bool all_reachable(const FA& fa) {
+    std::vector<bool> seen(fa.state_count());
+    seen[0] = true;
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (const transition& t : fa.transitions) {
+            if (seen[t.src] && !seen[t.dst])
+                seen[t.dst] = changed = true;
+        }
+    }
+    for (bool b : seen) {
+        if (!b)
+            return false;
+    }
+    return true;
+}
+
+template <auto& pattern>
+void check_epsilon_free(std::string_view alphabet) {
+    using C = compiled<pattern>;
+    static_assert(C::nfa.epsilon_free && !has_epsilon(C::nfa));
+    static_assert(has_epsilon(C::thompson_nfa));
+    static_assert(C::nfa.state_count() <= C::thompson_nfa.state_count());
+
+    CHECK(all_reachable(C::nfa));
+    for_inputs(alphabet, 6, 30, 300, [](const std::string& s) {
+        bool expected = simulate(C::thompson_nfa, s);
+        CHECK_ON(s, simulate(C::nfa, s) == expected);
+        CHECK_ON(s, oracle_match<pattern>(s) == expected);
+    });
+}
+
+int main() {
+    check_epsilon_free<literal>("abc");
+    check_epsilon_free<alternation>("abcd");
+    check_epsilon_free<nested>("abcdef");
+    check_epsilon_free<star_star>("ab");
+    check_epsilon_free<optional>("abcd");
+    check_epsilon_free<counted>("abc");
+
+    // states entered only through epsilon transitions are gone
+    static_assert(compiled<nested>::nfa.state_count() < compiled<nested>::thompson_nfa.state_count());
+
+    return test_result("epsilon");
+}
@@ -0,0 +1,78 @@
+// The flat parser against the type-based one: on patterns both can read
+// they must build the same Thompson NFA and capture program. Long patterns
+// only the flat parser can read are checked against std::regex.
+
+#include "test.h"
+#include <capture.h>
+
+static constexpr fixed_string alternation("abc|a(b|c)*|[x-z]+");
+static constexpr fixed_string modifiers("a*b+c?(de)*(f|g)+h?");
+static constexpr fixed_string groups("((a)|(b(c)?))*d");
+static constexpr fixed_string classes("[^a-c]\\d\\w*\\s?.[a\\-]");
+static constexpr fixed_string repeats("(ab|c){2,4}(a?){0,3}x{3}(y*){2,}");
+static constexpr fixed_string escapes("\\(\\)\\*\\n\\t|\\.+");
+
+static constexpr fixed_string unbalanced("(ab|c");
+static constexpr fixed_string dangling("*a");
+
+// 120 keywords, 778 characters
+static constexpr fixed_string keywords("aac|abihi|aedf|aeffif|afgb|ahfbbgd|ahigggg|ajc|baejhegf|bagh|bbigcfc|bcccac|bdaeef|bdbdh|bdhc|bdjajjg|beddd|beh|beifcfdi|bfjabdj|bghcdcgi|bhadecd|bhf|bhh|bihegd|bjajdhig|bjbc|bjdbe|cabgie|cahaheb|cbjjdfbi|ccc|cdbj|cea|cefjfh|cehaicc|cgabi|cgbghf|cgfacabe|cgfbgh|dabggbd|dai|dbb|dbjcfeej|dbjicjgf|ddaede|ddihfaae|deahcce|deei|dgb|dheahbii|dheiehhh|djfeigc|eab|eacec|eacgi|eba|ebc|ebcf|ecdegifd|ecgiegf|echd|edjfhf|egci|egciij|ehciadif|ehic|eiddia|faeaa|fafihhag|fbeacg|fbfaff|fbghiaai|fdhhgaca|fdhj|fgdffb|fge|fhj|fja|fjhjh|gabijf|gagii|gdcbccdd|gejcaid|gfeeee|ggj|ghbchg|gicicii|hae|haf|hcejcaig|hcj|hcjjhfc|hdhbghi|hebcbf|hfc|hga|hgecgf|hhgbheaj|hidieid|hjc|hjhfe|iaie|ibh|icaabic|iciijajd|ide|ieddfd|iefcjieb|ifdjddg|iga|ihbiadd|ihfhe|iid|ijeib|ijidehi|jagaee|jbiafi|jei|jjfci");
+
+template <typename A, typename B>
+constexpr bool same_FA(const A& a, const B& b) {
+    if (a.size_transition() != b.size_transition() || a.size_final_state() != b.size_final_state())
+        return false;
+    for (int i = 0; i < a.size_transition(); i++) {
+        const transition& x = a.transitions[i];
+        const transition& y = b.transitions[i];
+        if (x.src != y.src || x.dst != y.dst || x.is_epsilon != y.is_epsilon || (!x.is_epsilon && (x.lo != y.lo || x.hi != y.hi)))
+            return false;
+    }
+    for (int i = 0; i < a.size_final_state(); i++) {
+        if (a.final_states[i] != b.final_states[i])
+            return false;
+    }
+    return true;
+}
+
+template <typename A, typename B>
+constexpr bool same_program(const A& a, const B& b) {
+    if (a.size != b.size || a.slot_count != b.slot_count)
+        return false;
+    for (int i = 0; i < a.size; i++) {
+        const instruction& x = a.code[i];
+        const instruction& y = b.code[i];
+        if (x.op != y.op || x.lo != y.lo || x.hi != y.hi || x.x != y.x || x.y != y.y)
+            return false;
+    }
+    return true;
+}
+
+template <auto& pattern>
+constexpr bool same_front_ends() {
+    using typed = build_capture_program<typename parser<pattern, parse_table>::AST>;
+    using flat  = flat_capture_program<flat_parser<pattern>::res>;
+
+    return same_FA(type_front_end<pattern>::thompson_nfa, flat_front_end<pattern>::thompson_nfa) &&
+           same_program(typed::res, flat::res) && typed::group_count == flat::group_count;
+}
+
+int main() {
+    static_assert(same_front_ends<alternation>());
+    static_assert(same_front_ends<modifiers>());
+    static_assert(same_front_ends<groups>());
+    static_assert(same_front_ends<classes>());
+    static_assert(same_front_ends<repeats>());
+    static_assert(same_front_ends<escapes>());
+
+    static_assert(!flat_parser<unbalanced>::res.correct);
+    static_assert(!flat_parser<dangling>::res.correct);
+
+    static_assert(compiled<keywords>::flat);
+    for_inputs("abcdefghij", 3, 10, 2000, [](std::string_view s) {
+        CHECK_ON(s, match<keywords>(s) == oracle_match<keywords>(s));
+    });
+    CHECK(match<keywords>("aac") && match<keywords>("jjfci"));
+
+    return test_result("flat");
+}
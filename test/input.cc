@@ -0,0 +1,59 @@
+// The ways match takes its input: string_view, pointer and length, and
+// iterator pairs over containers that aren't contiguous.
+
+#include "test.h"
+#include <deque>
+#include <list>
+#include <match.h>
+#include <vector>
+
+static constexpr fixed_string loop("a(b|c)*d");
+static constexpr fixed_string literal("abc");
+static constexpr fixed_string third_last("(a|b)*a(a|b)(a|b)");
+
+template <auto& pattern, typename Engine>
+void check_ranges(std::string_view s) {
+    bool expected = oracle_match<pattern>(s);
+
+    std::list<char>            list(s.begin(), s.end());
+    std::deque<char>           deque(s.begin(), s.end());
+    std::vector<unsigned char> bytes(s.begin(), s.end());
+
+    CHECK_ON(s, (match<pattern, Engine>(s) == expected));
+    CHECK_ON(s, (match<pattern, Engine>(s.data(), s.size()) == expected));
+    CHECK_ON(s, (match<pattern, Engine>(s.begin(), s.end()) == expected));
+    CHECK_ON(s, (match<pattern, Engine>(list.begin(), list.end()) == expected));
+    CHECK_ON(s, (match<pattern, Engine>(deque.begin(), deque.end()) == expected));
+    CHECK_ON(s, (match<pattern, Engine>(bytes.begin(), bytes.end()) == expected));
+}
+
+template <auto& pattern>
+void check_engines(std::string_view alphabet) {
+    for_inputs(alphabet, 5, 30, 200, [](std::string_view s) {
+        check_ranges<pattern, auto_engine>(s);
+        check_ranges<pattern, dfa_engine>(s);
+        check_ranges<pattern, codegen_engine>(s);
+        check_ranges<pattern, lazy_dfa_engine>(s);
+        check_ranges<pattern, pike_vm_engine>(s);
+        check_ranges<pattern, backtrack_engine>(s);
+    });
+}
+
+int main() {
+    check_engines<loop>("abcd");
+    check_engines<literal>("abc");
+    check_engines<third_last>("ab");
+
+    // only the range is read, what surrounds it doesn't count
+    std::string text = "xabcdx";
+    CHECK((match<loop>(text.data() + 1, 4)));
+    CHECK((match<loop>(text.begin() + 1, text.end() - 1)));
+    CHECK((!match<loop>(text.data() + 1, 3)));
+    CHECK((match<literal>(std::string_view(text).substr(1, 3))));
+
+    // a string literal is taken as a string_view, without its terminator
+    CHECK((match<literal>("abc")));
+    CHECK((!match<literal>("")));
+
+    return test_result("input");
+}
@@ -0,0 +1,63 @@
+// compiled<pattern>::stats, and what count_instrumentation counts for each
+// engine.
+
+#include "test.h"
+
+static constexpr fixed_string loop("a(b|c)*d");
+static constexpr fixed_string literal("hello");
+static constexpr fixed_string alternation("(ab|a)(bc|c)");
+static constexpr fixed_string wide("(a|b)*a(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)"
+                                   "(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)"
+                                   "(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)c");
+
+template <auto& pattern>
+struct tag {};
+
+template <auto& pattern, typename Engine>
+instrument_counts counts_of(std::string_view s) {
+    using I = count_instrumentation<tag<pattern>>;
+    I::reset();
+    match<pattern, Engine, I>(s);
+    return I::counts;
+}
+
+int main() {
+    // the stats describe the automata compiled<> holds
+    constexpr automaton_stats s = compiled<loop>::stats;
+    static_assert(std::string_view(s.engine) == "bit_parallel");
+    static_assert(s.dfa_states == compiled<loop>::dfa.state_count());
+    static_assert(s.thompson_states > s.nfa_states && s.epsilon_transitions > 0);
+    static_assert(s.table_bytes == sizeof(compiled<loop>::bit_parallel::res));
+
+    constexpr automaton_stats w = compiled<wide>::stats;
+    static_assert(std::string_view(w.engine) == "lazy_dfa" && w.dfa_states == 0);
+
+    // every byte is read and steps one DFA state
+    instrument_counts dfa = counts_of<loop, dfa_engine>("abcbcd");
+    CHECK(dfa.bytes_scanned == 6 && dfa.states_visited == 6);
+    CHECK(dfa.backtrack_pushes == 0 && dfa.prefilter_hits == 0);
+
+    // the pike VM counts the threads of each step
+    instrument_counts pike = counts_of<alternation, pike_vm_engine>("abc");
+    CHECK(pike.bytes_scanned == 3 && pike.states_visited >= 3);
+
+    CHECK((counts_of<alternation, backtrack_engine>("abc").backtrack_pushes > 0));
+
+    // "hello" only matches itself, the prefilter decides alone
+    instrument_counts exact = counts_of<literal, auto_engine>("hello");
+    CHECK(exact.prefilter_hits == 1 && exact.bytes_scanned == 0);
+    CHECK((counts_of<literal, auto_engine>("help").prefilter_hits == 1));
+
+    instrument_counts lazy = counts_of<wide, auto_engine>(std::string(64, 'a') + "c");
+    CHECK(lazy.bytes_scanned == 65);
+
+    // search counts the forward and the backward pass
+    using I = count_instrumentation<tag<loop>>;
+    I::reset();
+    CHECK(same(search<loop, dfa_engine, I>("xxabcdxx"), { true, 2, 4 }));
+    CHECK(I::counts.bytes_scanned >= 6);
+
+    static_assert(!no_instrumentation::enabled && count_instrumentation<>::enabled);
+
+    return test_result("instrument");
+}
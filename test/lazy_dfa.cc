@@ -0,0 +1,86 @@
+// The lazy DFA on a pattern with 2^13 DFA states: random inputs keep adding
+// states, so the cache fills, flushes and falls back to NFA simulation.
+
+#include "test.h"
+#include <thread>
+#include <vector>
+
+static constexpr fixed_string nested("((a|b)*c(d|e)*)*f");
+static constexpr fixed_string third_last("(a|b)*a(a|b)(a|b)");
+static constexpr fixed_string blow_up("(a|b)*a(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)");
+
+using L = lazy_dfa<compiled<blow_up>::compact>;
+
+// blow_up matches a's and b's whose 13th byte from the end is an a
+bool blow_up_match(const std::string& s) {
+    if (s.size() < 13 || s.find_first_not_of("ab") != std::string::npos)
+        return false;
+    return s[s.size() - 13] == 'a';
+}
+
+std::string random_input(std::mt19937& rng, size_t size) {
+    std::string res(size, 'a');
+    for (char& c : res) {
+        c = "ab"[rng() % 2];
+    }
+    return res;
+}
+
+template <auto& pattern>
+void check_lazy_dfa(std::string_view alphabet) {
+    for_inputs(alphabet, 6, 40, 500, [](std::string_view s) {
+        CHECK_ON(s, (match<pattern, lazy_dfa_engine>(s) == oracle_match<pattern>(s)));
+    });
+}
+
+int main() {
+    static_assert(!compiled<blow_up>::determinize::fits);
+
+    check_lazy_dfa<nested>("abcdef");
+    check_lazy_dfa<third_last>("ab");
+
+    std::mt19937 rng(12345);
+    auto&        cache = L::local_cache();
+
+    // a fresh cache fills within a few hundred bytes, well before it paid
+    // for itself, and the rest of the input is simulated
+    cache.flush();
+    std::string s = random_input(rng, 2000);
+    CHECK_ON(s, (match<blow_up, lazy_dfa_engine>(s) == blow_up_match(s)));
+    CHECK(cache.size == L::CAPACITY);
+
+    // the simulated bytes count, so the next new state flushes the cache
+    CHECK(cache.bytes_since_flush >= size_t(lazy_dfa_min_bytes_per_state) * L::CAPACITY);
+    s = random_input(rng, 50);
+    CHECK_ON(s, (match<blow_up, lazy_dfa_engine>(s) == blow_up_match(s)));
+    CHECK(cache.size < L::CAPACITY);
+
+    // whatever the cache holds, every answer is right
+    for (int i = 0; i < 2000; i++) {
+        s = random_input(rng, rng() % 300);
+        if (!s.empty() && rng() % 8 == 0)
+            s[rng() % s.size()] = 'c';
+        CHECK_ON(s, (match<blow_up, lazy_dfa_engine>(s) == blow_up_match(s)));
+    }
+
+    // every thread has a cache of its own
+    std::vector<std::thread> threads;
+    std::vector<int>         failures(4);
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([t, &failures] {
+            std::mt19937 rng(t);
+            for (int i = 0; i < 500; i++) {
+                std::string s = random_input(rng, rng() % 1000);
+                failures[t] += match<blow_up, lazy_dfa_engine>(s) != blow_up_match(s);
+            }
+        });
+    }
+    for (std::thread& t : threads) {
+        t.join();
+    }
+    for (int f : failures) {
+        CHECK(f == 0);
+    }
+
+    return test_result("lazy_dfa");
+}
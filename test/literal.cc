@@ -0,0 +1,91 @@
+// Literal analysis and the prefilter built on it: the literals are
+// required by every match, so the prefilter never rejects a matching input.
+
+#include "test.h"
+#include <match.h>
+
+static constexpr fixed_string exact("abc");
+static constexpr fixed_string affixes("ab(c|d)*ef");
+static constexpr fixed_string factor("(a|b)*hello(a|b)*");
+static constexpr fixed_string shared("(abcx|abdy)z");
+static constexpr fixed_string counted("(ab){3}c?");
+static constexpr fixed_string loose("(a|b)*");
+static constexpr fixed_string long_factor("(a|b)*0123456789abcdefghijklmnopqrstuvwxyz(a|b)*");
+
+constexpr bool is(const literal& lit, std::string_view s) {
+    if (lit.size != static_cast<int>(s.size()))
+        return false;
+    for (int i = 0; i < lit.size; i++) {
+        if (lit[i] != s[i])
+            return false;
+    }
+    return true;
+}
+
+template <auto& pattern>
+void check_prefilter(std::string_view alphabet) {
+    for_inputs(alphabet, 6, 60, 1000, [](const std::string& s) {
+        bool expected = oracle_match<pattern>(s);
+        if (expected)
+            CHECK_ON(s, prefilter_match(compiled<pattern>::literals::res, s.data(), s.size()));
+        CHECK_ON(s, match<pattern>(s) == expected);
+    });
+}
+
+void check_find_literal() {
+    std::mt19937 rng(12345);
+    for (int i = 0; i < 2000; i++) {
+        std::string s(rng() % 80, 'a');
+        for (char& c : s) {
+            c = "ab"[rng() % 2];
+        }
+        literal lit;
+        lit.size = 1 + rng() % 5;
+        for (int k = 0; k < lit.size; k++) {
+            lit.data[k] = "ab"[rng() % 2];
+        }
+
+        size_t from     = rng() % (s.size() + 1);
+        size_t expected = std::string_view(s).find(std::string_view(lit.data, lit.size), from);
+        if (expected == std::string_view::npos)
+            expected = s.size();
+        CHECK_ON(s, find_literal(lit, s.data(), from, s.size()) == expected);
+    }
+}
+
+int main() {
+    constexpr literal_info e = compiled<exact>::literals::res;
+    static_assert(e.exact && is(e.prefix, "abc") && is(e.suffix, "abc"));
+
+    constexpr literal_info a = compiled<affixes>::literals::res;
+    static_assert(!a.exact && is(a.prefix, "ab") && is(a.suffix, "ef"));
+
+    constexpr literal_info f = compiled<factor>::literals::res;
+    static_assert(is(f.prefix, "") && is(f.suffix, "") && is(f.factor, "hello"));
+
+    // alternatives share their common prefix and suffix
+    constexpr literal_info s = compiled<shared>::literals::res;
+    static_assert(is(s.prefix, "ab") && is(s.suffix, "z") && is(s.factor, "ab"));
+
+    constexpr literal_info c = compiled<counted>::literals::res;
+    static_assert(is(c.prefix, "ababab") && is(c.suffix, ""));
+
+    static_assert(compiled<loose>::literals::res.factor.size == 0);
+
+    // cut down to the capacity
+    static_assert(compiled<long_factor>::literals::res.factor.size == literal::capacity);
+
+    check_prefilter<exact>("abc");
+    check_prefilter<affixes>("abcdef");
+    check_prefilter<factor>("abhelo");
+    check_prefilter<shared>("abcdxyz");
+    check_prefilter<counted>("abc");
+    check_prefilter<loose>("ab");
+    check_find_literal();
+
+    std::string text = "abab0123456789abcdefghijklmnopqrstuvwxyzba";
+    CHECK((match<long_factor>(text)));
+    CHECK((!match<long_factor>(text.substr(0, 20) + "X" + text.substr(21))));
+
+    return test_result("literal");
+}
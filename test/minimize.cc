@@ -0,0 +1,122 @@
+// FA_minimize against the DFA it minimizes: same language, every state
+// reachable and no two states equivalent.
+
+#include "test.h"
+#include <set>
+#include <utility>
+#include <vector>
+
+static constexpr fixed_string abb("(a|b)*abb");
+static constexpr fixed_string letters("a|b|c");
+static constexpr fixed_string redundant("(ab|ab|a(b))(c*|c*c)");
+static constexpr fixed_string nested("((a|b)*c(d|e)*)*f");
+static constexpr fixed_string third_last("(a|b)*a(a|b)(a|b)");
+static constexpr fixed_string classes("[a-c]+x?[0-9]*");
+
+// a chain of 128 states, each split off in a round of its own by Moore's
+// refinement
+static constexpr fixed_string chain("abcdefghabcdefghabcdefghabcdefgh"
+                                    "abcdefghabcdefghabcdefghabcdefgh"
+                                    "abcdefghabcdefghabcdefghabcdefgh"
+                                    "abcdefghabcdefghabcdefghabcdefgh");
+
+// walks both DFAs over every byte from their starting states, reachable
+// pairs of states must agree on finality
+template <typename A, typename B>
+bool equivalent(const A& a, const B& b) {
+    std::set<std::pair<int, int>>    seen;
+    std::vector<std::pair<int, int>> todo = { { a.start_state, b.start_state } };
+    seen.insert(todo[0]);
+
+    while (!todo.empty()) {
+        auto [s, t] = todo.back();
+        todo.pop_back();
+        if (a.is_final_state(s) != b.is_final_state(t))
+            return false;
+        for (int c = 0; c < 256; c++) {
+            std::pair<int, int> next = { a.next(s, c), b.next(t, c) };
+            if (seen.insert(next).second)
+                todo.push_back(next);
+        }
+    }
+    return true;
+}
+
+// Moore's algorithm, returns the number of classes of equivalent states
+template <typename A>
+int equivalence_classes(const A& a) {
+    int              n = a.state_count();
+    std::vector<int> block(n);
+    for (int s = 0; s < n; s++) {
+        block[s] = a.is_final_state(s);
+    }
+
+    for (int count = 0;;) {
+        std::set<std::vector<int>> signatures;
+        std::vector<std::vector<int>> sig(n);
+        for (int s = 0; s < n; s++) {
+            sig[s].push_back(block[s]);
+            for (int c = 0; c < 256; c++) {
+                sig[s].push_back(block[a.next(s, c)]);
+            }
+            signatures.insert(sig[s]);
+        }
+        if (int(signatures.size()) == count)
+            return count;
+
+        count = signatures.size();
+        for (int s = 0; s < n; s++) {
+            block[s] = std::distance(signatures.begin(), signatures.find(sig[s]));
+        }
+    }
+}
+
+template <typename A>
+int reachable(const A& a) {
+    std::vector<bool> seen(a.state_count());
+    std::vector<int>  todo = { a.start_state, a.dead_state };
+    seen[a.start_state] = seen[a.dead_state] = true;
+
+    int res = 2;
+    while (!todo.empty()) {
+        int s = todo.back();
+        todo.pop_back();
+        for (int c = 0; c < 256; c++) {
+            if (!seen[a.next(s, c)]) {
+                seen[a.next(s, c)] = true;
+                todo.push_back(a.next(s, c));
+                res++;
+            }
+        }
+    }
+    return res;
+}
+
+template <auto& pattern>
+void check_minimal() {
+    using C = compiled<pattern>;
+    static_assert(C::minimize::state_count <= C::determinize::res.state_count());
+
+    CHECK(equivalent(C::determinize::res, C::minimize::res));
+    CHECK(equivalence_classes(C::minimize::res) == C::minimize::state_count);
+    CHECK(reachable(C::minimize::res) == C::minimize::state_count);
+}
+
+int main() {
+    check_minimal<abb>();
+    check_minimal<letters>();
+    check_minimal<redundant>();
+    check_minimal<nested>();
+    check_minimal<third_last>();
+    check_minimal<classes>();
+    check_minimal<chain>();
+
+    // the textbook DFA of (a|b)*abb has 4 states, a|b|c 2, plus the dead
+    // state
+    static_assert(compiled<abb>::minimize::state_count == 5);
+    static_assert(compiled<letters>::minimize::state_count == 3);
+    static_assert(compiled<chain>::minimize::state_count == 130);
+    static_assert(compiled<redundant>::minimize::state_count < compiled<redundant>::determinize::res.state_count());
+
+    return test_result("minimize");
+}
@@ -0,0 +1,72 @@
+// match_parallel and search_parallel answer what match and search answer,
+// with matches placed across chunk boundaries.
+
+#include "test.h"
+#include <atomic>
+#include <parallel.h>
+#include <vector>
+
+static constexpr fixed_string third_last("(a|b)*a(a|b)(a|b)");
+static constexpr fixed_string nested("((a|b)*c(d|e)*)*f");
+static constexpr fixed_string needle("xy(z|w)*v");
+static constexpr fixed_string blow_up("(a|b)*a(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)");
+
+std::string random_input(std::mt19937& rng, std::string_view alphabet, size_t size) {
+    std::string res(size, ' ');
+    for (char& c : res) {
+        c = alphabet[rng() % alphabet.size()];
+    }
+    return res;
+}
+
+template <auto& pattern>
+void check_parallel(const std::string& s, thread_pool& pool) {
+    std::string_view head = std::string_view(s).substr(0, 40);
+    CHECK_ON(head, (match_parallel<pattern>(s, pool) == match<pattern>(s)));
+    CHECK_ON(head, same(search_parallel<pattern>(s, pool), search<pattern>(s)));
+}
+
+int main() {
+    thread_pool one(1), four(4);
+
+    std::atomic<size_t> sum{ 0 };
+    four.parallel_for(1000, [&](size_t i) { sum += i; });
+    CHECK(sum == 999 * 1000 / 2);
+    CHECK(one.size() == 1 && four.size() == 4);
+
+    std::mt19937 rng(12345);
+    size_t       size = 5 * parallel_min_chunk + 123;
+
+    for (int i = 0; i < 4; i++) {
+        std::string s = random_input(rng, "ab", size);
+        check_parallel<third_last>(s, four);
+        check_parallel<third_last>(s, one);
+        check_parallel<blow_up>(s, four);
+
+        s = random_input(rng, "abcde", size) + "f";
+        check_parallel<nested>(s, four);
+    }
+
+    // a single match that spans the boundary of two chunks, or none at all
+    std::string text = random_input(rng, "abcdvxz", size);
+    for (size_t i = 0; i < text.size(); i++) {
+        if (text[i] == 'x')
+            text[i] = 'a';
+    }
+    check_parallel<needle>(text, four);
+    CHECK(!search<needle>(text));
+
+    size_t chunk = size / parallel_chunk_count(size, four);
+    for (size_t at : { chunk - 3, chunk - 1, chunk, 2 * chunk + 1, size - 5 }) {
+        std::string s = text;
+        s.replace(at, 5, "xyzwv");
+        check_parallel<needle>(s, four);
+        CHECK_ON(std::to_string(at), same(search_parallel<needle>(s, four), { true, at, 5 }));
+    }
+
+    // too short to split, run on the calling thread
+    CHECK(match_parallel<third_last>("abb", four));
+    CHECK(same(search_parallel<needle>("..xyv..", four), { true, 2, 3 }));
+
+    return test_result("parallel");
+}
@@ -0,0 +1,49 @@
+// The pike VM and the backtracking walk, both on the compact NFA.
+
+#include "test.h"
+#include <match.h>
+
+static constexpr fixed_string literal("abc");
+static constexpr fixed_string alternation("(ab|a)(bc|c)");
+static constexpr fixed_string nested("((a|b)*c(d|e)*)*f");
+static constexpr fixed_string star_star("(a*)*b");
+static constexpr fixed_string optional("a?b?a?b?ab");
+static constexpr fixed_string third_last("(a|b)*a(a|b)(a|b)");
+
+template <auto& pattern>
+struct tag {};
+
+template <auto& pattern>
+void check_nfa_engines(std::string_view alphabet) {
+    for_inputs(alphabet, 6, 40, 500, [](const std::string& s) {
+        bool expected = oracle_match<pattern>(s);
+        CHECK_ON(s, (match<pattern, pike_vm_engine>(s) == expected));
+        CHECK_ON(s, (match<pattern, backtrack_engine>(s) == expected));
+    });
+}
+
+// each byte steps every NFA state at most once
+template <auto& pattern>
+void check_linear(const std::string& s, bool expected) {
+    using I = count_instrumentation<tag<pattern>>;
+    I::reset();
+    CHECK_ON(s, (match<pattern, pike_vm_engine, I>(s.begin(), s.end()) == expected));
+    CHECK_ON(s, I::counts.bytes_scanned <= s.size());
+    CHECK_ON(s, I::counts.states_visited <= s.size() * compiled<pattern>::nfa_state_count);
+}
+
+int main() {
+    check_nfa_engines<literal>("abc");
+    check_nfa_engines<alternation>("abc");
+    check_nfa_engines<nested>("abcdef");
+    check_nfa_engines<star_star>("ab");
+    check_nfa_engines<optional>("ab");
+    check_nfa_engines<third_last>("ab");
+
+    // a long run of a's without the b
+    check_linear<star_star>(std::string(100000, 'a'), false);
+    check_linear<star_star>(std::string(100000, 'a') + "b", true);
+    check_linear<third_last>(std::string(100000, 'b') + "abb", true);
+
+    return test_result("pike");
+}
@@ -0,0 +1,232 @@
+// regex_set against matching every pattern on its own with std::regex:
+// a small set that is determinized, and one of 60 patterns whose DFA is
+// over budget and runs on the lazy DFA.
+
+#include "test.h"
+#include <regex_set.h>
+
+static constexpr fixed_string get("GET /(a|b)*");
+static constexpr fixed_string post("POST /(a|b)*");
+static constexpr fixed_string any_slash("(E|G|O|P|S|T)+ /a*");
+
+// (a|b)*w and w(a|c)* for every w of three letters over abc, and a few
+// that match the empty string or overlap the others
+static constexpr fixed_string ends_aaa("(a|b)*aaa");
+static constexpr fixed_string ends_aab("(a|b)*aab");
+static constexpr fixed_string ends_aac("(a|b)*aac");
+static constexpr fixed_string ends_aba("(a|b)*aba");
+static constexpr fixed_string ends_abb("(a|b)*abb");
+static constexpr fixed_string ends_abc("(a|b)*abc");
+static constexpr fixed_string ends_aca("(a|b)*aca");
+static constexpr fixed_string ends_acb("(a|b)*acb");
+static constexpr fixed_string ends_acc("(a|b)*acc");
+static constexpr fixed_string ends_baa("(a|b)*baa");
+static constexpr fixed_string ends_bab("(a|b)*bab");
+static constexpr fixed_string ends_bac("(a|b)*bac");
+static constexpr fixed_string ends_bba("(a|b)*bba");
+static constexpr fixed_string ends_bbb("(a|b)*bbb");
+static constexpr fixed_string ends_bbc("(a|b)*bbc");
+static constexpr fixed_string ends_bca("(a|b)*bca");
+static constexpr fixed_string ends_bcb("(a|b)*bcb");
+static constexpr fixed_string ends_bcc("(a|b)*bcc");
+static constexpr fixed_string ends_caa("(a|b)*caa");
+static constexpr fixed_string ends_cab("(a|b)*cab");
+static constexpr fixed_string ends_cac("(a|b)*cac");
+static constexpr fixed_string ends_cba("(a|b)*cba");
+static constexpr fixed_string ends_cbb("(a|b)*cbb");
+static constexpr fixed_string ends_cbc("(a|b)*cbc");
+static constexpr fixed_string ends_cca("(a|b)*cca");
+static constexpr fixed_string ends_ccb("(a|b)*ccb");
+static constexpr fixed_string ends_ccc("(a|b)*ccc");
+static constexpr fixed_string starts_aaa("aaa(a|c)*");
+static constexpr fixed_string starts_aab("aab(a|c)*");
+static constexpr fixed_string starts_aac("aac(a|c)*");
+static constexpr fixed_string starts_aba("aba(a|c)*");
+static constexpr fixed_string starts_abb("abb(a|c)*");
+static constexpr fixed_string starts_abc("abc(a|c)*");
+static constexpr fixed_string starts_aca("aca(a|c)*");
+static constexpr fixed_string starts_acb("acb(a|c)*");
+static constexpr fixed_string starts_acc("acc(a|c)*");
+static constexpr fixed_string starts_baa("baa(a|c)*");
+static constexpr fixed_string starts_bab("bab(a|c)*");
+static constexpr fixed_string starts_bac("bac(a|c)*");
+static constexpr fixed_string starts_bba("bba(a|c)*");
+static constexpr fixed_string starts_bbb("bbb(a|c)*");
+static constexpr fixed_string starts_bbc("bbc(a|c)*");
+static constexpr fixed_string starts_bca("bca(a|c)*");
+static constexpr fixed_string starts_bcb("bcb(a|c)*");
+static constexpr fixed_string starts_bcc("bcc(a|c)*");
+static constexpr fixed_string starts_caa("caa(a|c)*");
+static constexpr fixed_string starts_cab("cab(a|c)*");
+static constexpr fixed_string starts_cac("cac(a|c)*");
+static constexpr fixed_string starts_cba("cba(a|c)*");
+static constexpr fixed_string starts_cbb("cbb(a|c)*");
+static constexpr fixed_string starts_cbc("cbc(a|c)*");
+static constexpr fixed_string starts_cca("cca(a|c)*");
+static constexpr fixed_string starts_ccb("ccb(a|c)*");
+static constexpr fixed_string starts_ccc("ccc(a|c)*");
+static constexpr fixed_string a_star("a*");
+static constexpr fixed_string ab_plus("(ab)+");
+static constexpr fixed_string counted("[abc]{2,4}");
+static constexpr fixed_string double_c("(a|b|c)*cc(a|b|c)*");
+static constexpr fixed_string optional("b?c?a");
+static constexpr fixed_string c_star("c*");
+
+template <auto&... patterns>
+void check_set(std::string_view alphabet, size_t max_size) {
+    using set = regex_set<patterns...>;
+
+    for_inputs(alphabet, 6, max_size, 500, [](std::string_view s) {
+        typename set::result res = set::match(s);
+
+        bool want[] = { oracle_match<patterns>(s)... };
+        int  first  = -1;
+        for (int i = 0; i < set::pattern_count; i++) {
+            CHECK_ON(s, res.test(i) == want[i]);
+            first = first < 0 && want[i] ? i : first;
+        }
+        CHECK_ON(s, set::first_match(s) == first);
+        CHECK_ON(s, set::match(s.data(), s.size()) == res);
+    });
+}
+
+using routes = regex_set<get, post, any_slash>;
+
+using large = regex_set<ends_aaa,
+                        ends_aab,
+                        ends_aac,
+                        ends_aba,
+                        ends_abb,
+                        ends_abc,
+                        ends_aca,
+                        ends_acb,
+                        ends_acc,
+                        ends_baa,
+                        ends_bab,
+                        ends_bac,
+                        ends_bba,
+                        ends_bbb,
+                        ends_bbc,
+                        ends_bca,
+                        ends_bcb,
+                        ends_bcc,
+                        ends_caa,
+                        ends_cab,
+                        ends_cac,
+                        ends_cba,
+                        ends_cbb,
+                        ends_cbc,
+                        ends_cca,
+                        ends_ccb,
+                        ends_ccc,
+                        starts_aaa,
+                        starts_aab,
+                        starts_aac,
+                        starts_aba,
+                        starts_abb,
+                        starts_abc,
+                        starts_aca,
+                        starts_acb,
+                        starts_acc,
+                        starts_baa,
+                        starts_bab,
+                        starts_bac,
+                        starts_bba,
+                        starts_bbb,
+                        starts_bbc,
+                        starts_bca,
+                        starts_bcb,
+                        starts_bcc,
+                        starts_caa,
+                        starts_cab,
+                        starts_cac,
+                        starts_cba,
+                        starts_cbb,
+                        starts_cbc,
+                        starts_cca,
+                        starts_ccb,
+                        starts_ccc,
+                        a_star,
+                        ab_plus,
+                        counted,
+                        double_c,
+                        optional,
+                        c_star>;
+
+int main() {
+    static_assert(routes::dfa_fits);
+    static_assert(large::pattern_count == 60 && !large::dfa_fits);
+
+    check_set<get, post, any_slash>("GETPOS /ab", 8);
+    check_set<ends_aaa,
+              ends_aab,
+              ends_aac,
+              ends_aba,
+              ends_abb,
+              ends_abc,
+              ends_aca,
+              ends_acb,
+              ends_acc,
+              ends_baa,
+              ends_bab,
+              ends_bac,
+              ends_bba,
+              ends_bbb,
+              ends_bbc,
+              ends_bca,
+              ends_bcb,
+              ends_bcc,
+              ends_caa,
+              ends_cab,
+              ends_cac,
+              ends_cba,
+              ends_cbb,
+              ends_cbc,
+              ends_cca,
+              ends_ccb,
+              ends_ccc,
+              starts_aaa,
+              starts_aab,
+              starts_aac,
+              starts_aba,
+              starts_abb,
+              starts_abc,
+              starts_aca,
+              starts_acb,
+              starts_acc,
+              starts_baa,
+              starts_bab,
+              starts_bac,
+              starts_bba,
+              starts_bbb,
+              starts_bbc,
+              starts_bca,
+              starts_bcb,
+              starts_bcc,
+              starts_caa,
+              starts_cab,
+              starts_cac,
+              starts_cba,
+              starts_cbb,
+              starts_cbc,
+              starts_cca,
+              starts_ccb,
+              starts_ccc,
+              a_star,
+              ab_plus,
+              counted,
+              double_c,
+              optional,
+              c_star>("abc", 12);
+
+    CHECK(routes::first_match("POST /ab") == 1);
+    // (a|b)*ccc, aba(a|c)* and (a|b|c)*cc(a|b|c)*
+    large::result r = large::match("abaccc");
+    large::result want;
+    want.set(26);
+    want.set(27 + 3);
+    want.set(57);
+    CHECK(r == want);
+
+    return test_result("regex_set");
+}
@@ -0,0 +1,67 @@
+// Counted repetition x{m,n} against std::regex, for x that can and can't
+// match the empty string, on both front ends, and the size of the
+// epsilon-free NFA as n grows.
+
+#include "test.h"
+
+static constexpr fixed_string exact("(ab|c){3}");
+static constexpr fixed_string range("(ab|c){2,4}d?");
+static constexpr fixed_string at_least("a(b|cd){2,}");
+static constexpr fixed_string zero("x(ab){0,2}y");
+static constexpr fixed_string optional("(a?b?){2,4}");
+static constexpr fixed_string star_min("(a*){3,5}b");
+static constexpr fixed_string nullable_at_least("(a|b*){3,}c");
+static constexpr fixed_string nested("((a{1,2}b?){0,2}c){1,3}");
+
+// over 48 characters, read by the flat parser
+static constexpr fixed_string flat_range("(ab|c){2,4}d?(a?b?){2,4}(a*){3,5}b(a|b*){3,}c(ab){0,2}x?");
+
+static constexpr fixed_string nullable_50("(a?b?){0,50}");
+static constexpr fixed_string nullable_100("(a?b?){0,100}");
+static constexpr fixed_string star_50("(a*b?){3,50}c");
+static constexpr fixed_string star_100("(a*b?){3,100}c");
+static constexpr fixed_string plain_50("(ab|c){2,50}");
+static constexpr fixed_string plain_100("(ab|c){2,100}");
+
+static constexpr fixed_string a_or_b("(a|b)*");
+static constexpr fixed_string a_or_b_c("(a|b)*c");
+
+// std::regex backtracks through every way to split the input among the
+// copies, the large counts are checked against a reference pattern with
+// the same language on inputs shorter than the count
+template <auto& pattern, auto& reference = pattern>
+void check_repeat(std::string_view alphabet, size_t max_size = 16) {
+    for_inputs(alphabet, 6, max_size, 400, [](std::string_view s) {
+        bool want = oracle_match<reference>(s);
+        CHECK_ON(s, match<pattern>(s) == want);
+        CHECK_ON(s, (match<pattern, pike_vm_engine>(s) == want));
+        CHECK_ON(s, (match<pattern, lazy_dfa_engine>(s) == want));
+    });
+}
+
+// twice the count, at most about twice the transitions
+template <auto& small, auto& large>
+constexpr bool linear() {
+    return compiled<large>::stats.nfa_transitions <= 2 * compiled<small>::stats.nfa_transitions + 8;
+}
+
+int main() {
+    static_assert(compiled<flat_range>::flat);
+    static_assert(linear<nullable_50, nullable_100>());
+    static_assert(linear<star_50, star_100>());
+    static_assert(linear<plain_50, plain_100>());
+
+    check_repeat<exact>("abc");
+    check_repeat<range>("abcd");
+    check_repeat<at_least>("abcd");
+    check_repeat<zero>("abxy");
+    check_repeat<optional>("ab");
+    check_repeat<star_min>("ab");
+    check_repeat<nullable_at_least>("abc");
+    check_repeat<nested>("abc");
+    check_repeat<flat_range>("abcdx", 20);
+    check_repeat<nullable_100, a_or_b>("abc", 40);
+    check_repeat<star_100, a_or_b_c>("abc", 40);
+
+    return test_result("repeat");
+}
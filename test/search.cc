@@ -0,0 +1,52 @@
+// Unanchored leftmost-longest search, forward and reversed DFA with
+// accelerated states, and the pike VM. Several patterns share this
+// translation unit on purpose: tables of different patterns with the same
+// shape must not get mixed up.
+
+#include "test.h"
+
+static constexpr fixed_string request("GET /(a|b)+");
+static constexpr fixed_string dot_a_dot(".a.");
+static constexpr fixed_string optional_three("(a?){3}");
+static constexpr fixed_string alternation("abcd|c");
+static constexpr fixed_string empty_match("b*");
+static constexpr fixed_string a_any_b("a.*b");
+static constexpr fixed_string nested("((a|b)*c(d|e)*)*f");
+static constexpr fixed_string classes("[a-c]+x?[0-9]");
+
+template <auto& pattern>
+void check_search(std::string_view alphabet, size_t max_size = 30) {
+    static_assert(compiled_search<pattern>::dfa_fits);
+
+    for_inputs(alphabet, 5, max_size, 400, [](const std::string& s) {
+        search_result want = oracle_search<pattern>(s);
+        CHECK_ON(s, same(search<pattern, dfa_engine>(s), want));
+        CHECK_ON(s, same(search<pattern, pike_vm_engine>(s), want));
+        CHECK_ON(s, same(search<pattern>(s.data(), s.size()), want));
+    });
+}
+
+int main() {
+    check_search<request>("GET /ab", 40);
+    check_search<dot_a_dot>("ab\n");
+    check_search<optional_three>("ab");
+    check_search<alternation>("abcdx");
+    check_search<empty_match>("ab");
+    check_search<a_any_b>("ab\nx");
+    check_search<nested>("abcdef");
+    check_search<classes>("abcx5");
+
+    // the starting state of GET / only leaves on 'G'
+    constexpr auto& acc = compiled_search<request>::accelerate::res;
+    static_assert(acc[compiled_search<request>::forward::res.start_state].n_bytes == 1);
+
+    // the cases the mixed-up tables got wrong
+    CHECK(same(search<optional_three>("abbbbbbbaab"), { true, 0, 1 }));
+    CHECK(same(search<dot_a_dot>("abbbbbbbaab"), { true, 7, 3 }));
+
+    // the end doesn't move over bytes skipped in a state that isn't final
+    CHECK(same(search<a_any_b>("xxaabaa"), { true, 2, 3 }));
+    CHECK(same(search<a_any_b>("ba\nabaa"), { true, 3, 2 }));
+
+    return test_result("search");
+}
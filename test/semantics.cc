@@ -0,0 +1,58 @@
+// search_as with each of the four semantics, on the DFAs and on the pike
+// VM, against the brute-force reference.
+
+#include "test.h"
+
+static constexpr fixed_string a_run("a+");
+static constexpr fixed_string prefixes("ab|a|abcd");
+static constexpr fixed_string overlap("(a|ab)(c|bcd)");
+static constexpr fixed_string empty_match("a*");
+static constexpr fixed_string delimited("x(a|b)*y");
+static constexpr fixed_string pairs("(ab)*a");
+static constexpr fixed_string third_last("(a|b)*a(a|b)(a|b)");
+
+template <auto& pattern, typename Semantics, typename Engine>
+void check_semantics(std::string_view s) {
+    search_result want = oracle_search<pattern>(s, Semantics::anchored, Semantics::longest);
+    CHECK_ON(s, (same(search_as<pattern, Semantics, Engine>(s), want)));
+}
+
+template <auto& pattern, typename Engine>
+void check_engine(std::string_view s) {
+    check_semantics<pattern, leftmost_longest, Engine>(s);
+    check_semantics<pattern, leftmost_shortest, Engine>(s);
+    check_semantics<pattern, anchored_longest, Engine>(s);
+    check_semantics<pattern, anchored_shortest, Engine>(s);
+}
+
+template <auto& pattern>
+void check_all(std::string_view alphabet) {
+    for_inputs(alphabet, 5, 16, 300, [](std::string_view s) {
+        check_engine<pattern, auto_engine>(s);
+        check_engine<pattern, dfa_engine>(s);
+        check_engine<pattern, pike_vm_engine>(s);
+    });
+}
+
+int main() {
+    check_all<a_run>("ab");
+    check_all<prefixes>("abcd");
+    check_all<overlap>("abcd");
+    check_all<empty_match>("ab");
+    check_all<delimited>("abxy");
+    check_all<pairs>("ab");
+    check_all<third_last>("abc");
+
+    // the four answers on one input
+    CHECK((same(search_as<prefixes, leftmost_longest>("xxabcdab"), { true, 2, 4 })));
+    CHECK((same(search_as<prefixes, leftmost_shortest>("xxabcdab"), { true, 2, 1 })));
+    CHECK((same(search_as<prefixes, anchored_longest>("abcdab"), { true, 0, 4 })));
+    CHECK((same(search_as<prefixes, anchored_shortest>("abcdab"), { true, 0, 1 })));
+    CHECK((!search_as<prefixes, anchored_longest>("xabcd")));
+
+    // the empty match at the start
+    CHECK((same(search_as<empty_match, leftmost_shortest>("aaa"), { true, 0, 0 })));
+    CHECK((same(search_as<empty_match, leftmost_longest>("baaa"), { true, 0, 0 })));
+
+    return test_result("semantics");
+}
@@ -0,0 +1,77 @@
+// stream_matcher and stream_searcher fed in chunks of random sizes must
+// agree with matching or searching the whole input at once.
+
+#include "test.h"
+#include <stream.h>
+
+static constexpr fixed_string alternation("a(ab|cd)+");           // bit-parallel
+static constexpr fixed_string wide("(a|b)*a(a|b)(a|b)(a|b)(a|b)(a|b)c");  // DFA
+static constexpr fixed_string a_any_b("a.*b");
+static constexpr fixed_string request("GET /(a|b)+");
+static constexpr fixed_string optional_three("(a?){3}");
+
+// 71 positions, too many for the bit-parallel engine and a DFA over the
+// budget: the pike VM
+static constexpr fixed_string pike("(a|b)*a(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)"
+                                   "(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)"
+                                   "(a|b)(a|b)(a|b)(a|b)c");
+
+// splits s at random points
+template <typename Stream>
+void feed_chunks(Stream& st, std::string_view s, std::mt19937& rng) {
+    for (size_t idx = 0; idx < s.size();) {
+        size_t n = 1 + rng() % 4;
+        n        = n < s.size() - idx ? n : s.size() - idx;
+        st.feed(s.substr(idx, n));
+        idx += n;
+    }
+}
+
+template <auto& pattern>
+void check_matcher(std::string_view alphabet, size_t max_size = 40) {
+    std::mt19937 rng(1);
+    for_inputs(alphabet, 5, max_size, 400, [&](std::string_view s) {
+        stream_matcher<pattern> m;
+        feed_chunks(m, s, rng);
+        bool want = oracle_match<pattern>(s);
+        CHECK_ON(s, m.finish() == want);
+        CHECK_ON(s, !m.rejected() || !want);
+    });
+}
+
+template <auto& pattern>
+void check_searcher(std::string_view alphabet, size_t max_size = 40) {
+    std::mt19937 rng(2);
+    for_inputs(alphabet, 5, max_size, 400, [&](std::string_view s) {
+        stream_searcher<pattern> st;
+        feed_chunks(st, s, rng);
+        search_result want = oracle_search<pattern>(s);
+        CHECK_ON(s, st.finish() == want.matched);
+        CHECK_ON(s, !want || st.match_end() == want.position + want.length);
+    });
+}
+
+int main() {
+    check_matcher<alternation>("abcd");
+    check_matcher<wide>("abc");
+    check_matcher<pike>("abc", 60);
+    check_matcher<a_any_b>("ab\n");
+
+    check_searcher<request>("GET /ab");
+    check_searcher<alternation>("abcd");
+    check_searcher<a_any_b>("abx\n");
+    check_searcher<optional_three>("ab");
+
+    // the end stays where the last final state was, the skipped "aa" is
+    // looped over in a state that isn't final
+    stream_searcher<a_any_b> st;
+    st.feed("xxaa");
+    st.feed("baa");
+    CHECK(st.found() && st.match_end() == 5);
+
+    stream_matcher<alternation> m;
+    m.feed("b");
+    CHECK(m.rejected());
+
+    return test_result("stream");
+}
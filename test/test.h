@@ -0,0 +1,134 @@
+#ifndef CTRE_TEST_TEST_H
+#define CTRE_TEST_TEST_H
+
+// Shared by the tests. Results are compared with std::regex in ECMAScript
+// mode, which reads the syntax the tests use the same way as long as inputs
+// stay within ASCII and avoid '\r' (ECMAScript's . doesn't match it).
+
+#include <cstdio>
+#include <random>
+#include <regex>
+#include <search.h>
+#include <string>
+#include <string_view>
+
+inline int test_failures = 0;
+
+// only the first few failures are printed, all of them are counted
+static constexpr int test_print_limit = 20;
+
+inline std::string escaped(std::string_view s) {
+    std::string res;
+    for (unsigned char c : s) {
+        if (c == '\n')
+            res += "\\n";
+        else if (c < 0x20 || c >= 0x7f) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\x%02x", c);
+            res += buf;
+        } else
+            res += static_cast<char>(c);
+    }
+    return res;
+}
+
+inline void check(bool ok, const char* what, const char* file, int line, std::string_view input) {
+    if (ok)
+        return;
+    if (test_failures++ < test_print_limit)
+        printf("%s:%d: %s failed on \"%s\"\n", file, line, what, escaped(input).c_str());
+}
+
+#define CHECK(cond) check((cond), #cond, __FILE__, __LINE__, "")
+#define CHECK_ON(input, cond) check((cond), #cond, __FILE__, __LINE__, (input))
+
+// prints the summary, the exit status of the test
+inline int test_result(const char* name) {
+    if (test_failures)
+        printf("%s: %d failed\n", name, test_failures);
+    else
+        printf("%s: ok\n", name);
+    return test_failures ? 1 : 0;
+}
+
+//
+// Inputs
+//
+
+// Calls f on every string over alphabet of up to `exhaustive` bytes, then
+// on `count` random strings of up to max_size bytes. The seed is fixed so
+// failures reproduce.
+template <typename F>
+void for_inputs(std::string_view alphabet, size_t exhaustive, size_t max_size, int count, F f) {
+    std::string s;
+    auto        all = [&](auto& self, size_t size) -> void {
+        f(s);
+        if (size == exhaustive)
+            return;
+        for (char c : alphabet) {
+            s.push_back(c);
+            self(self, size + 1);
+            s.pop_back();
+        }
+    };
+    all(all, 0);
+
+    std::mt19937 rng(12345);
+    for (int i = 0; i < count; i++) {
+        s.resize(rng() % (max_size + 1));
+        for (char& c : s) {
+            c = alphabet[rng() % alphabet.size()];
+        }
+        f(s);
+    }
+}
+
+//
+// Oracle
+//
+
+template <auto& pattern>
+std::string pattern_source() {
+    std::string res;
+    for (int i = 0; i < pattern.size(); i++) {
+        res += pattern[i];
+    }
+    return res;
+}
+
+template <auto& pattern>
+const std::regex& oracle() {
+    static const std::regex re(pattern_source<pattern>());
+    return re;
+}
+
+template <auto& pattern>
+bool oracle_match(std::string_view s) {
+    return std::regex_match(s.begin(), s.end(), oracle<pattern>());
+}
+
+// Tries every start and every end, the reference for search_as.
+template <auto& pattern>
+search_result oracle_search(std::string_view s, bool anchored = false, bool longest = true) {
+    for (size_t start = 0; start <= (anchored ? 0 : s.size()); start++) {
+        search_result res;
+        for (size_t end = start; end <= s.size(); end++) {
+            if (std::regex_match(s.begin() + start, s.begin() + end, oracle<pattern>())) {
+                res = { true, start, end - start };
+                if (!longest)
+                    break;
+            }
+        }
+        if (res)
+            return res;
+    }
+    return {};
+}
+
+inline bool same(const search_result& lhs, const search_result& rhs) {
+    if (!lhs || !rhs)
+        return lhs.matched == rhs.matched;
+    return lhs.position == rhs.position && lhs.length == rhs.length;
+}
+
+#endif